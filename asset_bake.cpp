@@ -0,0 +1,155 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "asset_pack.h"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Packs ROOT/textures (decoded to RGBA8) and ROOT/fonts (as is) into one
+// file the client maps at startup.
+//
+// Usage: asset_bake OUTPUT ROOT
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct BakedAsset {
+    std::string          name;
+    AssetKind            kind {};
+    uint32_t             width {};
+    uint32_t             height {};
+    std::vector<uint8_t> bytes;
+};
+
+bool read_file(const fs::path& path, std::vector<uint8_t>& bytes)
+{
+    FILE* file = fopen(path.string().c_str(), "rb");
+    if (!file)
+        return false;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    bytes.resize(size > 0 ? static_cast<size_t>(size) : 0);
+    bool ok = fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    fclose(file);
+    return ok;
+}
+
+std::vector<fs::path> list_files(const fs::path& dir)
+{
+    std::vector<fs::path> files;
+    std::error_code       ec;
+    for (const fs::directory_entry& entry : fs::directory_iterator(dir, ec)) {
+        if (entry.is_regular_file())
+            files.push_back(entry.path());
+    }
+    // Stable output for identical inputs.
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        fprintf(stderr, "Usage: asset_bake OUTPUT ROOT\n");
+        return 1;
+    }
+
+    const char*             output = argv[1];
+    fs::path                root   = argv[2];
+    std::vector<BakedAsset> assets;
+
+    for (const fs::path& path : list_files(root / "textures")) {
+        if (path.extension() != ".png")
+            continue;
+
+        int            width, height, channels;
+        unsigned char* pixels = stbi_load(path.string().c_str(), &width, &height, &channels, 4);
+        if (!pixels) {
+            fprintf(stderr, "Failed to load %s: %s\n", path.string().c_str(), stbi_failure_reason());
+            return 1;
+        }
+
+        BakedAsset asset;
+        asset.name   = "textures/" + path.filename().string();
+        asset.kind   = AssetKind::Texture;
+        asset.width  = static_cast<uint32_t>(width);
+        asset.height = static_cast<uint32_t>(height);
+        asset.bytes.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+        assets.push_back(std::move(asset));
+    }
+
+    for (const fs::path& path : list_files(root / "fonts")) {
+        BakedAsset asset;
+        asset.name = "fonts/" + path.filename().string();
+        asset.kind = AssetKind::Raw;
+        if (!read_file(path, asset.bytes)) {
+            fprintf(stderr, "Failed to read %s\n", path.string().c_str());
+            return 1;
+        }
+        assets.push_back(std::move(asset));
+    }
+
+    std::vector<AssetPackEntry> entries(assets.size());
+    uint64_t                    offset = sizeof(AssetPackHeader) + entries.size() * sizeof(AssetPackEntry);
+
+    for (size_t i = 0; i < assets.size(); ++i) {
+        if (assets[i].name.size() >= ASSET_NAME_SIZE) {
+            fprintf(stderr, "Asset name too long: %s\n", assets[i].name.c_str());
+            return 1;
+        }
+
+        offset = (offset + ASSET_PACK_ALIGN - 1) / ASSET_PACK_ALIGN * ASSET_PACK_ALIGN;
+
+        AssetPackEntry& entry = entries[i];
+        memset(&entry, 0, sizeof(entry));
+        memcpy(entry.name, assets[i].name.data(), assets[i].name.size());
+        entry.kind   = assets[i].kind;
+        entry.width  = assets[i].width;
+        entry.height = assets[i].height;
+        entry.offset = offset;
+        entry.size   = assets[i].bytes.size();
+
+        offset += entry.size;
+    }
+
+    FILE* file = fopen(output, "wb");
+    if (!file) {
+        fprintf(stderr, "Can't open %s for writing\n", output);
+        return 1;
+    }
+
+    AssetPackHeader header {};
+    memcpy(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic));
+    header.version = ASSET_PACK_VERSION;
+    header.count   = static_cast<uint32_t>(entries.size());
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(entries.data(), sizeof(AssetPackEntry), entries.size(), file);
+
+    static const uint8_t zeros[ASSET_PACK_ALIGN] {};
+    for (size_t i = 0; i < assets.size(); ++i) {
+        long pos = ftell(file);
+        fwrite(zeros, 1, entries[i].offset - static_cast<uint64_t>(pos), file);
+        fwrite(assets[i].bytes.data(), 1, assets[i].bytes.size(), file);
+    }
+
+    bool ok = ferror(file) == 0;
+    ok      = fclose(file) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Failed writing %s\n", output);
+        return 1;
+    }
+
+    printf("Baked %zu assets into %s (%llu bytes)\n", assets.size(), output, (unsigned long long)offset);
+    return 0;
+}
@@ -0,0 +1,269 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "asset_loader.h"
+#include "stb_image.h"
+
+#include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_timer.h>
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+constexpr int    PLACEHOLDER_SIZE = 8;
+constexpr size_t PAGE_SIZE        = 4096;
+
+// Faults the mapped pages in on the worker, so the upload on the main
+// thread doesn't stall on disk.
+void prefault(const uint8_t* data, size_t size)
+{
+    volatile uint8_t sink = 0;
+    for (size_t i = 0; i < size; i += PAGE_SIZE) {
+        sink = sink + data[i];
+    }
+}
+
+bool read_file(const std::string& path, std::vector<uint8_t>& bytes)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    bytes.resize(size > 0 ? static_cast<size_t>(size) : 0);
+    bool ok = fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    fclose(file);
+    return ok;
+}
+
+}
+
+AssetLoader::~AssetLoader()
+{
+    shutdown();
+}
+
+void AssetLoader::init(SDL_Renderer* renderer, const AssetPack* pack, unsigned threads)
+{
+    m_renderer    = renderer;
+    m_pack        = pack && pack->is_open() ? pack : nullptr;
+    m_texture_dir = std::string(SDL_GetBasePath()) + "../textures/";
+
+    // Magenta/black checker, loud enough to notice if something never loads.
+    uint32_t pixels[PLACEHOLDER_SIZE * PLACEHOLDER_SIZE];
+    for (int y = 0; y < PLACEHOLDER_SIZE; ++y) {
+        for (int x = 0; x < PLACEHOLDER_SIZE; ++x) {
+            pixels[y * PLACEHOLDER_SIZE + x] = ((x ^ y) & 1) ? 0xFFFF00FF : 0xFF000000;
+        }
+    }
+    m_placeholder = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+        PLACEHOLDER_SIZE, PLACEHOLDER_SIZE);
+    if (m_placeholder) {
+        SDL_UpdateTexture(m_placeholder, nullptr, pixels, PLACEHOLDER_SIZE * 4);
+        SDL_SetTextureScaleMode(m_placeholder, SDL_SCALEMODE_NEAREST);
+    }
+
+    for (unsigned i = 0; i < std::max(1u, threads); ++i) {
+        m_workers.emplace_back([this](std::stop_token stop) { worker_loop(stop); });
+    }
+}
+
+void AssetLoader::shutdown()
+{
+    for (std::jthread& worker : m_workers) {
+        worker.request_stop();
+    }
+    m_jobs_cv.notify_all();
+    m_workers.clear(); // joins
+
+    m_jobs.clear();
+    m_results.clear();
+    m_ready.clear();
+
+    for (auto& [name, slot] : m_textures) {
+        if (slot.texture)
+            SDL_DestroyTexture(slot.texture);
+    }
+    m_textures.clear();
+    m_files.clear();
+
+    if (m_placeholder) {
+        SDL_DestroyTexture(m_placeholder);
+        m_placeholder = nullptr;
+    }
+}
+
+void AssetLoader::request_texture(const std::string& name, TextureReady on_ready)
+{
+    auto [it, inserted] = m_textures.try_emplace(name);
+    TextureSlot& slot   = it->second;
+
+    if (slot.done) {
+        if (slot.texture)
+            on_ready(slot.texture, slot.width, slot.height);
+        return;
+    }
+
+    slot.waiting.push_back(std::move(on_ready));
+    if (inserted)
+        enqueue(Kind::Texture, name);
+}
+
+void AssetLoader::request_file(const std::string& name, FileReady on_ready)
+{
+    auto [it, inserted] = m_files.try_emplace(name);
+    FileSlot& slot      = it->second;
+
+    if (slot.done) {
+        if (slot.data)
+            on_ready(slot.data, slot.size);
+        return;
+    }
+
+    slot.waiting.push_back(std::move(on_ready));
+    if (inserted)
+        enqueue(Kind::File, name);
+}
+
+void AssetLoader::enqueue(Kind kind, const std::string& name)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_jobs_mutex);
+        m_jobs.push_back({ kind, name });
+    }
+    m_jobs_cv.notify_one();
+}
+
+void AssetLoader::worker_loop(std::stop_token stop)
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_jobs_mutex);
+            if (!m_jobs_cv.wait(lock, stop, [this] { return !m_jobs.empty(); }))
+                return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        Result result { job.kind, job.name };
+        load(job, result);
+
+        std::lock_guard<std::mutex> lock(m_results_mutex);
+        m_results.push_back(std::move(result));
+    }
+}
+
+void AssetLoader::load(const Job& job, Result& result) const
+{
+    std::string pack_name = job.kind == Kind::Texture ? "textures/" + job.name : job.name;
+
+    if (const AssetPackEntry* entry = m_pack ? m_pack->find(pack_name) : nullptr) {
+        if (job.kind == Kind::Texture && entry->kind != AssetKind::Texture)
+            return;
+
+        result.data   = m_pack->data(*entry);
+        result.size   = static_cast<size_t>(entry->size);
+        result.width  = static_cast<int>(entry->width);
+        result.height = static_cast<int>(entry->height);
+        prefault(result.data, result.size);
+        return;
+    }
+
+    if (job.kind == Kind::File) {
+        read_file(job.name, result.owned);
+        return;
+    }
+
+    std::string path = m_texture_dir + job.name;
+    int         width, height, channels;
+    uint8_t*    pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (!pixels) {
+        SDL_Log("Failed to load image %s: %s", path.c_str(), stbi_failure_reason());
+        return;
+    }
+
+    result.owned.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    result.width  = width;
+    result.height = height;
+    stbi_image_free(pixels);
+}
+
+void AssetLoader::pump(double budget_ms)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_results_mutex);
+        for (Result& result : m_results) {
+            m_ready.push_back(std::move(result));
+        }
+        m_results.clear();
+    }
+
+    // Keep a burst of loads (a late join spawning many players) from
+    // landing in one frame; whatever is left waits for the next pump.
+    uint64_t start = SDL_GetPerformanceCounter();
+    uint64_t limit = static_cast<uint64_t>(budget_ms * 1e-3 * static_cast<double>(SDL_GetPerformanceFrequency()));
+    while (!m_ready.empty()) {
+        finish(m_ready.front());
+        m_ready.pop_front();
+        if (SDL_GetPerformanceCounter() - start >= limit)
+            break;
+    }
+}
+
+void AssetLoader::finish(Result& result)
+{
+    if (!result.owned.empty()) {
+        result.data = result.owned.data();
+        result.size = result.owned.size();
+    }
+
+    if (result.kind == Kind::File) {
+        FileSlot& slot = m_files[result.name];
+        slot.done      = true;
+        slot.owned     = std::move(result.owned);
+        slot.data      = slot.owned.empty() ? result.data : slot.owned.data();
+        slot.size      = result.size;
+        if (!slot.data) {
+            SDL_Log("Failed to load %s", result.name.c_str());
+        }
+
+        // Callbacks may request more assets, which can rehash the map.
+        const uint8_t*         data    = slot.data;
+        size_t                 size    = slot.size;
+        std::vector<FileReady> waiting = std::move(slot.waiting);
+        for (FileReady& on_ready : waiting) {
+            if (data)
+                on_ready(data, size);
+        }
+        return;
+    }
+
+    TextureSlot& slot = m_textures[result.name];
+    slot.done         = true;
+    if (result.data) {
+        slot.texture = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STATIC,
+            result.width, result.height);
+        if (slot.texture) {
+            SDL_UpdateTexture(slot.texture, nullptr, result.data, result.width * 4);
+            SDL_SetTextureBlendMode(slot.texture, SDL_BLENDMODE_BLEND);
+        } else {
+            SDL_Log("Failed to create texture %s: %s", result.name.c_str(), SDL_GetError());
+        }
+        slot.width  = result.width;
+        slot.height = result.height;
+    }
+
+    // Entities waiting on a failed load just keep the placeholder.
+    SDL_Texture*              texture = slot.texture;
+    int                       width   = slot.width;
+    int                       height  = slot.height;
+    std::vector<TextureReady> waiting = std::move(slot.waiting);
+    for (TextureReady& on_ready : waiting) {
+        if (texture)
+            on_ready(texture, width, height);
+    }
+}
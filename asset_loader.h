@@ -0,0 +1,105 @@
+#pragma once
+
+#include "asset_pack.h"
+
+#include <SDL3/SDL_render.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Loads textures and raw files off the main thread. Workers read (from the
+// asset pack when there is one) and decode; pump() uploads finished images
+// on the render thread and runs the callbacks waiting on them. Everything is
+// cached by name and owned by the loader, entities only borrow textures.
+class AssetLoader {
+public:
+    using TextureReady = std::function<void(SDL_Texture* texture, int width, int height)>;
+    using FileReady    = std::function<void(const uint8_t* data, size_t size)>;
+
+    ~AssetLoader();
+
+    void init(SDL_Renderer* renderer, const AssetPack* pack, unsigned threads);
+    void shutdown(); // joins the workers and frees every cached asset
+
+    // Shown in place of textures that are still loading.
+    SDL_Texture* placeholder() const { return m_placeholder; }
+
+    // `name` is relative to textures/. Runs on_ready right away when the
+    // texture is already resident, otherwise from a later pump().
+    void request_texture(const std::string& name, TextureReady on_ready);
+
+    // `name` is the pack name and the path relative to the working directory.
+    // The bytes stay valid until shutdown().
+    void request_file(const std::string& name, FileReady on_ready);
+
+    // Uploads finished loads until budget_ms is spent (at least one per
+    // call). Main thread only.
+    void pump(double budget_ms);
+
+private:
+    enum class Kind : uint8_t {
+        Texture,
+        File,
+    };
+
+    struct Job {
+        Kind        kind;
+        std::string name;
+    };
+
+    struct Result {
+        Kind                 kind;
+        std::string          name;
+        const uint8_t*       data {}; // into the pack or `owned`
+        size_t               size {};
+        int                  width {};
+        int                  height {};
+        std::vector<uint8_t> owned;
+    };
+
+    struct TextureSlot {
+        SDL_Texture*              texture {};
+        int                       width {};
+        int                       height {};
+        bool                      done {};
+        std::vector<TextureReady> waiting;
+    };
+
+    struct FileSlot {
+        const uint8_t*         data {};
+        size_t                 size {};
+        std::vector<uint8_t>   owned;
+        bool                   done {};
+        std::vector<FileReady> waiting;
+    };
+
+    void worker_loop(std::stop_token stop);
+    void load(const Job& job, Result& result) const;
+    void enqueue(Kind kind, const std::string& name);
+    void finish(Result& result);
+
+    SDL_Renderer*    m_renderer {};
+    const AssetPack* m_pack {};
+    SDL_Texture*     m_placeholder {};
+    std::string      m_texture_dir;
+
+    // main thread only
+    std::unordered_map<std::string, TextureSlot> m_textures;
+    std::unordered_map<std::string, FileSlot>    m_files;
+    std::deque<Result>                           m_ready;
+
+    std::mutex                  m_jobs_mutex;
+    std::condition_variable_any m_jobs_cv;
+    std::deque<Job>             m_jobs;
+
+    std::mutex          m_results_mutex;
+    std::vector<Result> m_results;
+
+    std::vector<std::jthread> m_workers;
+};
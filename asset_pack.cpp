@@ -0,0 +1,134 @@
+#include "asset_pack.h"
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+AssetPack::~AssetPack()
+{
+    close();
+}
+
+bool AssetPack::open(const char* path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    HANDLE        mapping = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+
+    m_base = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_base) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    m_size    = static_cast<size_t>(size.QuadPart);
+    m_file    = file;
+    m_mapping = mapping;
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* base = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    if (base == MAP_FAILED)
+        return false;
+
+    m_base = static_cast<const uint8_t*>(base);
+    m_size = static_cast<size_t>(st.st_size);
+#endif
+
+    AssetPackHeader header;
+    if (m_size < sizeof(header)) {
+        close();
+        return false;
+    }
+    memcpy(&header, m_base, sizeof(header));
+
+    if (memcmp(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic)) != 0
+        || header.version != ASSET_PACK_VERSION
+        || m_size < sizeof(header) + static_cast<uint64_t>(header.count) * sizeof(AssetPackEntry)) {
+        close();
+        return false;
+    }
+
+    m_entries = reinterpret_cast<const AssetPackEntry*>(m_base + sizeof(header));
+    m_count   = header.count;
+
+    for (uint32_t i = 0; i < m_count; ++i) {
+        const AssetPackEntry& entry = m_entries[i];
+        if (entry.offset > m_size || entry.size > m_size - entry.offset) {
+            close();
+            return false;
+        }
+        // The loader hands textures to SDL as width * height RGBA8 pixels
+        // with an int pitch, straight from the mapping.
+        if (entry.kind == AssetKind::Texture
+            && (entry.width > INT32_MAX / 4 || entry.height > INT32_MAX
+                || entry.size < static_cast<uint64_t>(entry.width) * entry.height * 4)) {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void AssetPack::close()
+{
+    if (!m_base)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_base);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file    = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(m_base), m_size);
+#endif
+
+    m_base    = nullptr;
+    m_size    = 0;
+    m_entries = nullptr;
+    m_count   = 0;
+}
+
+const AssetPackEntry* AssetPack::find(std::string_view name) const
+{
+    // A handful of entries, a linear scan beats building a map at startup.
+    for (uint32_t i = 0; i < m_count; ++i) {
+        const AssetPackEntry& entry = m_entries[i];
+        if (strnlen(entry.name, ASSET_NAME_SIZE) == name.size()
+            && memcmp(entry.name, name.data(), name.size()) == 0)
+            return &entry;
+    }
+    return nullptr;
+}
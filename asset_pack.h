@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// A pack is a file header, `count` entries, then the asset blobs. Textures
+// are stored decoded as RGBA8 (SDL_PIXELFORMAT_ABGR8888 on little endian),
+// straight alpha, rows tightly packed. Anything else is stored as is. Blobs
+// start on ASSET_PACK_ALIGN boundaries so they can be used straight from
+// the mapping.
+
+enum class AssetKind : uint8_t {
+    Texture = 0,
+    Raw     = 1,
+};
+
+constexpr char     ASSET_PACK_MAGIC[4] = { 'C', 'P', 'A', 'K' };
+constexpr uint16_t ASSET_PACK_VERSION  = 1;
+constexpr uint32_t ASSET_PACK_ALIGN    = 64;
+constexpr size_t   ASSET_NAME_SIZE     = 64;
+
+#pragma pack(push, 1)
+struct AssetPackHeader {
+    char     magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t count;
+};
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+struct AssetPackEntry {
+    char      name[ASSET_NAME_SIZE]; // e.g. "textures/hey.png", zero padded
+    AssetKind kind;
+    uint32_t  width; // textures only
+    uint32_t  height;
+    uint64_t  offset; // from the start of the file
+    uint64_t  size;
+};
+#pragma pack(pop)
+
+// Read-only view of a pack mapped into memory. Pointers returned by data()
+// stay valid until close().
+class AssetPack {
+public:
+    ~AssetPack();
+
+    bool open(const char* path);
+    void close();
+    bool is_open() const { return m_base != nullptr; }
+
+    const AssetPackEntry* find(std::string_view name) const;
+    const uint8_t*        data(const AssetPackEntry& entry) const { return m_base + entry.offset; }
+
+private:
+    const uint8_t*        m_base {};
+    size_t                m_size {};
+    const AssetPackEntry* m_entries {};
+    uint32_t              m_count {};
+#ifdef _WIN32
+    void* m_file {};
+    void* m_mapping {};
+#endif
+};
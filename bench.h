@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+// Runs `fn` repeatedly until at least `min_seconds` have elapsed and returns
+// the mean wall time of one call in nanoseconds.
+template <typename Fn>
+double bench_ns_per_call(Fn&& fn, double min_seconds = 0.25)
+{
+    using clock = std::chrono::steady_clock;
+
+    fn(); // warm caches and page in the working set
+
+    size_t     calls = 0;
+    const auto start = clock::now();
+    auto       now   = start;
+    do {
+        fn();
+        ++calls;
+        now = clock::now();
+    } while (std::chrono::duration<double>(now - start).count() < min_seconds);
+
+    return std::chrono::duration<double, std::nano>(now - start).count() / calls;
+}
+
+// Adds one timing to the report bench_main writes with --json and checks
+// against --baseline. Names are "suite/case/variant"; lower is better.
+void bench_report(const std::string& name, double ns);
+
+void bench_bullets();
+void bench_serialize();
+void bench_dispatch();
@@ -0,0 +1,158 @@
+#include "bench.h"
+#include "bullet_kernel.h"
+#include "sim.h"
+
+#include <cmath>
+#include <cstring>
+#include <flecs.h>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct BulletSoA {
+    std::vector<Position>  pos;
+    std::vector<Direction> dir;
+    std::vector<Speed>     speed;
+    std::vector<Range>     range;
+    std::vector<RectF>     rect;
+
+    BulletColumns columns()
+    {
+        return { pos.data(), dir.data(), speed.data(), range.data(), rect.data(), pos.size() };
+    }
+};
+
+BulletSoA make_bullets(size_t count)
+{
+    std::mt19937                          rng(1234);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> coord(-5000.0f, 5000.0f);
+
+    BulletSoA b;
+    b.pos.resize(count);
+    b.dir.resize(count);
+    b.speed.resize(count);
+    b.range.resize(count);
+    b.rect.resize(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        float a    = angle(rng);
+        b.pos[i]   = { coord(rng), coord(rng) };
+        b.dir[i]   = { std::cos(a), std::sin(a) };
+        b.speed[i] = { 500.0f };
+        // Roughly one bullet in a hundred is already spent.
+        b.range[i] = { (i % 97 == 0) ? 0.0f : 1.0e9f };
+        b.rect[i].rect = { 0.0f, 0.0f, 14.0f, 14.0f };
+    }
+    return b;
+}
+
+bool same_result(const BulletSoA& a, const BulletSoA& b)
+{
+    size_t n = a.pos.size();
+    return memcmp(a.pos.data(), b.pos.data(), n * sizeof(Position)) == 0
+        && memcmp(a.range.data(), b.range.data(), n * sizeof(Range)) == 0
+        && memcmp(a.rect.data(), b.rect.data(), n * sizeof(RectF)) == 0;
+}
+
+}
+
+void bench_bullets()
+{
+    constexpr float dt = 1.0f / 60.0f;
+
+    struct Candidate {
+        BulletKernel kernel;
+        bool         supported;
+    };
+    const Candidate candidates[] = {
+        { integrate_bullets_scalar, true },
+        { integrate_bullets_sse, cpu_has_sse2() },
+        { integrate_bullets_avx2, cpu_has_avx2() },
+    };
+
+    printf("bullet_physics (selected kernel: %s)\n", bullet_kernel_name(select_bullet_kernel()));
+    printf("%10s %8s %12s %10s %8s\n", "bullets", "kernel", "ns/bullet", "ms/tick", "speedup");
+
+    for (size_t count : { size_t { 1'000 }, size_t { 10'000 }, size_t { 100'000 }, size_t { 1'000'000 } }) {
+        const BulletSoA initial = make_bullets(count);
+
+        // Every kernel must produce bit-identical output to the scalar one.
+        BulletSoA reference = initial;
+        std::vector<uint32_t> expired(count);
+        integrate_bullets_scalar(reference.columns(), dt, expired.data());
+
+        double scalar_ns = 0.0;
+        for (const Candidate& c : candidates) {
+            if (!c.supported)
+                continue;
+
+            BulletSoA check = initial;
+            c.kernel(check.columns(), dt, expired.data());
+            if (!same_result(reference, check)) {
+                printf("%10zu %8s  MISMATCH against scalar kernel\n", count, bullet_kernel_name(c.kernel));
+                continue;
+            }
+
+            BulletSoA work = initial;
+            double    ns   = bench_ns_per_call([&] {
+                c.kernel(work.columns(), dt, expired.data());
+            });
+            if (c.kernel == integrate_bullets_scalar)
+                scalar_ns = ns;
+
+            bench_report(std::string("bullets/") + bullet_kernel_name(c.kernel) + "/" + std::to_string(count), ns / count);
+            printf("%10zu %8s %12.3f %10.3f %7.2fx\n",
+                count,
+                bullet_kernel_name(c.kernel),
+                ns / count,
+                ns * 1e-6,
+                scalar_ns / ns);
+        }
+    }
+
+    // The whole bullet_physics system as the simulation runs it, including
+    // flecs iteration and the expired-bullet cleanup around the kernel.
+    printf("\nbullet_physics system (sim_step, one thread)\n");
+    printf("%10s %12s %10s\n", "bullets", "ns/bullet", "ms/tick");
+    for (int count : { 1'000, 10'000, 100'000 }) {
+        flecs::world ecs;
+        SimSystems   sim = sim_init(ecs);
+
+        std::mt19937                          rng(99);
+        std::uniform_real_distribution<float> coord(-5000.0f, 5000.0f);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        for (int i = 0; i < count; ++i) {
+            spawn_bullet(ecs, Position { coord(rng), coord(rng) },
+                normalize_vector(Direction { unit(rng), unit(rng) }),
+                Speed { BASE_BULLET_SPEED }, Damage { BASE_BULLET_DAMAGE }, Range { 1.0e9f }, false,
+                DEFAULT_BULLET_SIZE, DEFAULT_BULLET_SIZE);
+        }
+
+        double ns = bench_ns_per_call([&] {
+            sim_step(ecs, sim, SIM_FIXED_DT);
+        });
+        bench_report("sim_step/bullets/" + std::to_string(count), ns / count);
+        printf("%10d %12.3f %10.3f\n", count, ns / count, ns * 1e-6);
+    }
+
+    constexpr size_t VECTORS = 4096;
+    std::vector<Direction> input(VECTORS);
+    std::vector<Direction> output(VECTORS);
+    std::mt19937                          rng(7);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (Direction& d : input) {
+        d = { unit(rng), unit(rng) };
+    }
+    input[0] = { 0.0f, 0.0f }; // the zero-length branch
+
+    double ns = bench_ns_per_call([&] {
+        for (size_t i = 0; i < VECTORS; ++i) {
+            output[i] = normalize_vector(input[i]);
+        }
+    });
+    bench_report("normalize_vector/direction", ns / VECTORS);
+    printf("\nnormalize_vector %.3f ns/vector\n", ns / VECTORS);
+}
@@ -0,0 +1,154 @@
+#include "bench.h"
+#include "game_room.h"
+#include "message_batch.h"
+#include "net_schema.h"
+
+#include <string>
+#include <vector>
+
+// Room logging would dominate the timings; the benchmark drops it.
+void printt(const char*, ...) { }
+
+namespace {
+
+// A tick budget no benchmark tick gets near, so the load governor never
+// starts shedding what is being measured.
+constexpr double UNLIMITED_TICK_MS = 1.0e9;
+constexpr float  TICK_DT           = 1.0f / 30.0f;
+
+// Without a sockets interface the room does everything up to the library
+// call: encoding, fan-out, stats and the priority queues. Sends land
+// nowhere, which is the mock.
+struct BenchRoom {
+    GameRoom room { 0, nullptr, nullptr, 48 * 1024, UNLIMITED_TICK_MS };
+    size_t   clients {};
+
+    explicit BenchRoom(size_t count, bool rate_limited = false)
+        : clients(count)
+    {
+        room.set_rate_limited(rate_limited);
+        for (size_t i = 0; i < count; ++i) {
+            HSteamNetConnection conn = static_cast<HSteamNetConnection>(i + 1);
+            room.post_join(conn, "bench" + std::to_string(i));
+            post(conn, MsgPlayerJoined { 0, position(i) });
+        }
+        room.update(TICK_DT);
+        room.send(TICK_DT);
+    }
+
+    template <typename T>
+    void post(HSteamNetConnection conn, const T& msg)
+    {
+        uint8_t buffer[encoded_message_size<T>()];
+        size_t  size = encode_message(msg, buffer, sizeof(buffer));
+        room.post_message(conn, buffer, static_cast<uint32>(size));
+    }
+
+    static Position position(size_t i)
+    {
+        return { (i % 16) * 200.0f, (i / 16) * 200.0f };
+    }
+};
+
+// One client sending a full batch of records; nobody to forward them to, so
+// this is decode and the handle_record switch. With the rate limits on, past
+// the first few ticks nearly every record is over its limit instead.
+void bench_records(bool rate_limited)
+{
+    BenchRoom    bench(1, rate_limited);
+    MessageBatch batch;
+
+    MsgSpawnBullet bullet {};
+    bullet.direction = { 0.6f, 0.8f };
+    bullet.speed     = { 500.0f };
+    bullet.range     = { 1000.0f };
+    for (size_t i = 0; batch.append(Position { i * 1.0f, 2.0f }) && batch.append(bullet); ++i) {
+    }
+
+    size_t         size;
+    const uint8_t* data    = batch.finish(size);
+    uint32_t       records = batch.records();
+
+    double ns = bench_ns_per_call([&] {
+        bench.room.post_message(1, data, static_cast<uint32>(size));
+        bench.room.update(TICK_DT);
+        bench.room.send(TICK_DT);
+    });
+    const char* name = rate_limited ? "records rate limited" : "records";
+    bench_report(rate_limited ? "dispatch/records/limited" : "dispatch/records", ns / records);
+    printf("%-24s %8u %12.2f\n", name, records, ns / records);
+}
+
+// Every client sends a Direction each tick and the room relays it to all
+// the others through send_data_to_all_clients.
+void bench_relay(size_t clients)
+{
+    BenchRoom bench(clients);
+    uint64_t  sent  = bench.room.stats().messages_sent;
+    size_t    ticks = 0;
+
+    double ns = bench_ns_per_call([&] {
+        for (size_t i = 0; i < clients; ++i) {
+            bench.post(static_cast<HSteamNetConnection>(i + 1), Direction { 0.6f, 0.8f });
+        }
+        bench.room.update(TICK_DT);
+        bench.room.send(TICK_DT);
+        ++ticks;
+    });
+
+    // Nothing relayed means nothing per send to report; inf would poison
+    // the JSON and any baseline compared against it.
+    double sends = double(bench.room.stats().messages_sent - sent) / ticks;
+    if (sends == 0) {
+        printf("%-24s %8zu %12s\n", "relay Direction", clients, "none sent");
+        return;
+    }
+    bench_report("dispatch/relay/" + std::to_string(clients), ns / sends);
+    printf("%-24s %8zu %12.2f %12.0f %10.3f\n", "relay Direction", clients, ns / sends, sends, ns * 1e-6);
+}
+
+// Every client moves each tick; positions go through each receiver's
+// priority queue and out as batches under the byte budget.
+void bench_positions(size_t clients)
+{
+    BenchRoom bench(clients);
+    uint64_t  sent  = bench.room.stats().updates_sent;
+    size_t    ticks = 0;
+
+    double ns = bench_ns_per_call([&] {
+        for (size_t i = 0; i < clients; ++i) {
+            Position pos = BenchRoom::position(i);
+            pos.x += ticks % 7;
+            bench.post(static_cast<HSteamNetConnection>(i + 1), pos);
+        }
+        bench.room.update(TICK_DT);
+        bench.room.send(TICK_DT);
+        ++ticks;
+    });
+
+    double updates = double(bench.room.stats().updates_sent - sent) / ticks;
+    if (updates == 0) {
+        printf("%-24s %8zu %12s\n", "queue Position", clients, "none sent");
+        return;
+    }
+    bench_report("dispatch/positions/" + std::to_string(clients), ns / updates);
+    printf("%-24s %8zu %12.2f %12.0f %10.3f\n", "queue Position", clients, ns / updates, updates, ns * 1e-6);
+}
+
+}
+
+void bench_dispatch()
+{
+    printf("\ndispatch (GameRoom, no sockets)\n");
+    printf("%-24s %8s %12s\n", "case", "records", "ns/record");
+    bench_records(false);
+    bench_records(true);
+
+    printf("%-24s %8s %12s %12s %10s\n", "case", "clients", "ns/send", "sends/tick", "ms/tick");
+    for (size_t clients : { 8, 64, 256 }) {
+        bench_relay(clients);
+    }
+    for (size_t clients : { 8, 64, 256 }) {
+        bench_positions(clients);
+    }
+}
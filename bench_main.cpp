@@ -0,0 +1,127 @@
+#include "bench.h"
+#include "net_schema.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Runs every suite and prints the tables. With --json the timings are also
+// written as {"results": {"name": ns, ...}}; with --baseline they are
+// compared against such a file from an earlier run, and the exit code is 1
+// if any got slower by more than --tolerance percent.
+//
+// Usage: bench [--json FILE] [--baseline FILE] [--tolerance PERCENT]
+
+namespace {
+
+std::vector<std::pair<std::string, double>> g_results;
+
+bool write_report(const char* path)
+{
+    std::ofstream out(path);
+    if (!out)
+        return false;
+
+    char protocol[16];
+    snprintf(protocol, sizeof(protocol), "%08x", PROTOCOL_HASH);
+    out << "{\n  \"protocol\": \"" << protocol << "\",\n  \"results\": {\n";
+    for (size_t i = 0; i < g_results.size(); ++i) {
+        char value[32];
+        snprintf(value, sizeof(value), "%.4f", g_results[i].second);
+        out << "    \"" << g_results[i].first << "\": " << value << (i + 1 < g_results.size() ? ",\n" : "\n");
+    }
+    out << "  }\n}\n";
+    return static_cast<bool>(out);
+}
+
+// Reads back what write_report wrote: one "name": number pair per line.
+// Lines whose value isn't a number (the protocol) are skipped.
+bool read_report(const char* path, std::map<std::string, double>& results)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t open  = line.find('"');
+        size_t close = open == std::string::npos ? open : line.find("\":", open + 1);
+        if (close == std::string::npos)
+            continue;
+
+        const char* value = line.c_str() + close + 2;
+        char*       end   = nullptr;
+        double      ns    = strtod(value, &end);
+        if (end != value) {
+            results[line.substr(open + 1, close - open - 1)] = ns;
+        }
+    }
+    return true;
+}
+
+int compare_with_baseline(const char* path, double tolerance)
+{
+    std::map<std::string, double> baseline;
+    if (!read_report(path, baseline)) {
+        printf("bench: can't read baseline %s\n", path);
+        return 1;
+    }
+
+    printf("\ncompared with %s (tolerance %.0f%%)\n", path, tolerance * 100.0);
+    printf("%-48s %12s %12s %8s\n", "name", "baseline", "now", "change");
+
+    int regressions = 0;
+    int compared    = 0;
+    for (const auto& [name, ns] : g_results) {
+        auto it = baseline.find(name);
+        if (it == baseline.end() || it->second <= 0.0)
+            continue;
+
+        ++compared;
+        double change = ns / it->second - 1.0;
+        bool   slower = change > tolerance;
+        regressions += slower;
+        printf("%-48s %12.3f %12.3f %+7.1f%%%s\n", name.c_str(), it->second, ns, change * 100.0,
+            slower ? "  REGRESSION" : "");
+    }
+
+    printf("%d compared, %d regressed, %zu not in baseline\n", compared, regressions,
+        g_results.size() - compared);
+    return regressions > 0 ? 1 : 0;
+}
+
+}
+
+void bench_report(const std::string& name, double ns)
+{
+    g_results.emplace_back(name, ns);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* json_path     = nullptr;
+    const char* baseline_path = nullptr;
+    double      tolerance     = 0.10;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--json"))
+            json_path = argv[i + 1];
+        else if (!strcmp(argv[i], "--baseline"))
+            baseline_path = argv[i + 1];
+        else if (!strcmp(argv[i], "--tolerance"))
+            tolerance = atof(argv[i + 1]) / 100.0;
+    }
+
+    bench_bullets();
+    bench_serialize();
+    bench_dispatch();
+
+    if (json_path && !write_report(json_path)) {
+        printf("bench: can't write %s\n", json_path);
+        return 1;
+    }
+    return baseline_path ? compare_with_baseline(baseline_path, tolerance) : 0;
+}
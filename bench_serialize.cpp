@@ -0,0 +1,127 @@
+#include "bench.h"
+#include "net_schema.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t BATCH = 1024;
+
+volatile uint32_t g_sink; // keeps the loops from being optimized away
+
+template <typename T>
+size_t encode_memcpy(const T& msg, uint8_t* out)
+{
+    MsgHeader header { MsgTraits<T>::type, static_cast<uint16_t>(sizeof(T)) };
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), &msg, sizeof(T));
+    return sizeof(header) + sizeof(T);
+}
+
+template <typename T>
+bool decode_memcpy(const uint8_t* data, size_t size, T& msg)
+{
+    MsgHeader header;
+    if (size < sizeof(header))
+        return false;
+    memcpy(&header, data, sizeof(header));
+    if (header.size != sizeof(T) || size < sizeof(header) + header.size)
+        return false;
+    memcpy(&msg, data + sizeof(header), sizeof(T));
+    return true;
+}
+
+MsgPlayerPositionChanged make(MsgPlayerPositionChanged*, size_t i)
+{
+    return { static_cast<uint32_t>(i), { i * 1.5f, i * -0.5f } };
+}
+
+MsgSpawnBullet make(MsgSpawnBullet*, size_t i)
+{
+    MsgSpawnBullet msg {};
+    msg.pos       = { i * 1.0f, i * 2.0f };
+    msg.direction = { 0.6f, 0.8f };
+    msg.speed     = { 500.0f };
+    msg.range     = { 1000.0f };
+    msg.damage    = { 10.0f, static_cast<float>(i) };
+    return msg;
+}
+
+MsgPlayerJoined make(MsgPlayerJoined*, size_t i)
+{
+    return { static_cast<uint32_t>(i), { i * 10.0f, i * 20.0f } };
+}
+
+template <typename T>
+void bench_message(const char* name)
+{
+    constexpr size_t SIZE = encoded_message_size<T>();
+    static_assert(SIZE == sizeof(MsgHeader) + sizeof(T), "schema and packed layout disagree");
+
+    std::vector<T> messages(BATCH);
+    for (size_t i = 0; i < BATCH; ++i) {
+        messages[i] = make(static_cast<T*>(nullptr), i);
+    }
+
+    std::vector<uint8_t> wire_memcpy(BATCH * SIZE);
+    std::vector<uint8_t> wire_schema(BATCH * SIZE);
+    for (size_t i = 0; i < BATCH; ++i) {
+        encode_memcpy(messages[i], &wire_memcpy[i * SIZE]);
+        encode_message(messages[i], &wire_schema[i * SIZE], SIZE);
+    }
+    if (wire_memcpy != wire_schema) {
+        printf("%-26s MISMATCH between schema and memcpy encoding\n", name);
+        return;
+    }
+
+    std::vector<T> decoded(BATCH);
+    uint32_t       sink = 0;
+
+    double enc_memcpy = bench_ns_per_call([&] {
+        for (size_t i = 0; i < BATCH; ++i) {
+            sink += static_cast<uint32_t>(encode_memcpy(messages[i], &wire_memcpy[i * SIZE]));
+        }
+    });
+    double enc_schema = bench_ns_per_call([&] {
+        for (size_t i = 0; i < BATCH; ++i) {
+            sink += static_cast<uint32_t>(encode_message(messages[i], &wire_schema[i * SIZE], SIZE));
+        }
+    });
+    double dec_memcpy = bench_ns_per_call([&] {
+        for (size_t i = 0; i < BATCH; ++i) {
+            sink += decode_memcpy(&wire_memcpy[i * SIZE], SIZE, decoded[i]);
+        }
+    });
+    double dec_schema = bench_ns_per_call([&] {
+        MsgHeader header;
+        for (size_t i = 0; i < BATCH; ++i) {
+            const uint8_t* data = &wire_schema[i * SIZE];
+            sink += decode_header(data, SIZE, header)
+                && decode_payload(data + MSG_HEADER_SIZE, header.size, decoded[i]);
+        }
+    });
+
+    g_sink = sink;
+
+    const std::string prefix = std::string("serialize/") + name + "/";
+    bench_report(prefix + "enc_memcpy", enc_memcpy / BATCH);
+    bench_report(prefix + "enc_schema", enc_schema / BATCH);
+    bench_report(prefix + "dec_memcpy", dec_memcpy / BATCH);
+    bench_report(prefix + "dec_schema", dec_schema / BATCH);
+
+    printf("%-26s %6zu %12.2f %12.2f %12.2f %12.2f\n", name, SIZE,
+        enc_memcpy / BATCH, enc_schema / BATCH, dec_memcpy / BATCH, dec_schema / BATCH);
+}
+
+}
+
+void bench_serialize()
+{
+    printf("\nserialize (protocol %08x, ns/message)\n", PROTOCOL_HASH);
+    printf("%-26s %6s %12s %12s %12s %12s\n", "message", "bytes", "enc memcpy", "enc schema", "dec memcpy", "dec schema");
+    bench_message<MsgPlayerPositionChanged>("MsgPlayerPositionChanged");
+    bench_message<MsgSpawnBullet>("MsgSpawnBullet");
+    bench_message<MsgPlayerJoined>("MsgPlayerJoined");
+}
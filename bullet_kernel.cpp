@@ -0,0 +1,261 @@
+#include "bullet_kernel.h"
+
+#include <bit>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BULLET_KERNEL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define BULLET_KERNEL_X86 0
+#endif
+
+// The AVX2 kernel is built with a per-function target so the rest of the
+// binary keeps the baseline instruction set and still runs on older CPUs.
+#if defined(__GNUC__) || defined(__clang__)
+#define BULLET_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BULLET_TARGET_AVX2
+#endif
+
+namespace {
+
+// The component structs are packed pairs/quads of floats, so every column
+// can be walked as a flat float array.
+struct FloatColumns {
+    float*       pos;
+    const float* dir;
+    const float* speed;
+    float*       range;
+    float*       rect;
+};
+
+FloatColumns as_floats(const BulletColumns& cols)
+{
+    static_assert(sizeof(Position) == 2 * sizeof(float));
+    static_assert(sizeof(Direction) == 2 * sizeof(float));
+    static_assert(sizeof(Speed) == sizeof(float));
+    static_assert(sizeof(Range) == sizeof(float));
+    static_assert(sizeof(RectF) == 4 * sizeof(float));
+
+    return {
+        reinterpret_cast<float*>(cols.pos),
+        reinterpret_cast<const float*>(cols.dir),
+        reinterpret_cast<const float*>(cols.speed),
+        reinterpret_cast<float*>(cols.range),
+        reinterpret_cast<float*>(cols.rect),
+    };
+}
+
+// Shared tail loop, also the whole scalar kernel.
+size_t integrate_rows_scalar(const FloatColumns& c, size_t begin, size_t end, float dt, uint32_t* expired, size_t n_expired)
+{
+    for (size_t i = begin; i < end; ++i) {
+        const float step = c.speed[i] * dt;
+
+        if (c.range[i] <= 0.0f) {
+            expired[n_expired++] = static_cast<uint32_t>(i);
+        }
+        c.range[i] -= step;
+
+        c.pos[2 * i]     += c.dir[2 * i] * step;
+        c.pos[2 * i + 1] += c.dir[2 * i + 1] * step;
+
+        float* r = c.rect + 4 * i;
+        r[0]     = c.pos[2 * i] - r[2] * 0.5f;
+        r[1]     = c.pos[2 * i + 1] - r[3] * 0.5f;
+    }
+    return n_expired;
+}
+
+size_t push_expired(uint32_t mask, size_t base, uint32_t* expired, size_t n_expired)
+{
+    while (mask) {
+        expired[n_expired++] = static_cast<uint32_t>(base + std::countr_zero(mask));
+        mask &= mask - 1;
+    }
+    return n_expired;
+}
+
+#if BULLET_KERNEL_X86
+
+inline void store_rect_sse(float* rect, __m128 xy_pair, __m128 half)
+{
+    __m128 r  = _mm_loadu_ps(rect);
+    __m128 wh = _mm_movehl_ps(r, r); // w h w h
+    __m128 xy = _mm_sub_ps(xy_pair, _mm_mul_ps(wh, half));
+    _mm_storeu_ps(rect, _mm_movelh_ps(xy, wh));
+}
+
+BULLET_TARGET_AVX2 size_t integrate_bullets_avx2_impl(const BulletColumns& cols, float dt, uint32_t* expired)
+{
+    const FloatColumns c         = as_floats(cols);
+    const size_t       n         = cols.count;
+    size_t             n_expired = 0;
+    size_t             i         = 0;
+
+    const __m256  vdt  = _mm256_set1_ps(dt);
+    const __m256  zero = _mm256_setzero_ps();
+    const __m256  half = _mm256_set1_ps(0.5f);
+    const __m256i lo_pair_idx = _mm256_setr_epi32(0, 1, 0, 1, 2, 3, 2, 3);
+    const __m256i hi_pair_idx = _mm256_setr_epi32(4, 5, 4, 5, 6, 7, 6, 7);
+
+    for (; i + 8 <= n; i += 8) {
+        __m256 step  = _mm256_mul_ps(_mm256_loadu_ps(c.speed + i), vdt);
+        __m256 range = _mm256_loadu_ps(c.range + i);
+
+        uint32_t dead = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(range, zero, _CMP_LE_OQ)));
+        _mm256_storeu_ps(c.range + i, _mm256_sub_ps(range, step));
+
+        // Widen the per-row step to match the interleaved x/y layout.
+        __m256 lo        = _mm256_unpacklo_ps(step, step); // s0 s0 s1 s1 | s4 s4 s5 s5
+        __m256 hi        = _mm256_unpackhi_ps(step, step); // s2 s2 s3 s3 | s6 s6 s7 s7
+        __m256 step_0123 = _mm256_permute2f128_ps(lo, hi, 0x20);
+        __m256 step_4567 = _mm256_permute2f128_ps(lo, hi, 0x31);
+
+        float* pos  = c.pos + 2 * i;
+        __m256 p0123 = _mm256_add_ps(_mm256_loadu_ps(pos), _mm256_mul_ps(_mm256_loadu_ps(c.dir + 2 * i), step_0123));
+        __m256 p4567 = _mm256_add_ps(_mm256_loadu_ps(pos + 8), _mm256_mul_ps(_mm256_loadu_ps(c.dir + 2 * i + 8), step_4567));
+        _mm256_storeu_ps(pos, p0123);
+        _mm256_storeu_ps(pos + 8, p4567);
+
+        // Each 256-bit load covers two rects: x y w h | x y w h.
+        float*       rect     = c.rect + 4 * i;
+        const __m256 pairs[4] = {
+            _mm256_permutevar8x32_ps(p0123, lo_pair_idx),
+            _mm256_permutevar8x32_ps(p0123, hi_pair_idx),
+            _mm256_permutevar8x32_ps(p4567, lo_pair_idx),
+            _mm256_permutevar8x32_ps(p4567, hi_pair_idx),
+        };
+        for (int k = 0; k < 4; ++k) {
+            __m256 r  = _mm256_loadu_ps(rect + 8 * k);
+            __m256 wh = _mm256_shuffle_ps(r, r, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 xy = _mm256_sub_ps(pairs[k], _mm256_mul_ps(wh, half));
+            _mm256_storeu_ps(rect + 8 * k, _mm256_blend_ps(xy, r, 0xCC));
+        }
+
+        n_expired = push_expired(dead, i, expired, n_expired);
+    }
+
+    return integrate_rows_scalar(c, i, n, dt, expired, n_expired);
+}
+
+#endif
+
+}
+
+size_t integrate_bullets_scalar(const BulletColumns& cols, float dt, uint32_t* expired)
+{
+    return integrate_rows_scalar(as_floats(cols), 0, cols.count, dt, expired, 0);
+}
+
+size_t integrate_bullets_sse(const BulletColumns& cols, float dt, uint32_t* expired)
+{
+#if BULLET_KERNEL_X86
+    const FloatColumns c         = as_floats(cols);
+    const size_t       n         = cols.count;
+    size_t             n_expired = 0;
+    size_t             i         = 0;
+
+    const __m128 vdt  = _mm_set1_ps(dt);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 step  = _mm_mul_ps(_mm_loadu_ps(c.speed + i), vdt);
+        __m128 range = _mm_loadu_ps(c.range + i);
+
+        uint32_t dead = static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(range, zero)));
+        _mm_storeu_ps(c.range + i, _mm_sub_ps(range, step));
+
+        float* pos = c.pos + 2 * i;
+        __m128 p01 = _mm_add_ps(_mm_loadu_ps(pos), _mm_mul_ps(_mm_loadu_ps(c.dir + 2 * i), _mm_unpacklo_ps(step, step)));
+        __m128 p23 = _mm_add_ps(_mm_loadu_ps(pos + 4), _mm_mul_ps(_mm_loadu_ps(c.dir + 2 * i + 4), _mm_unpackhi_ps(step, step)));
+        _mm_storeu_ps(pos, p01);
+        _mm_storeu_ps(pos + 4, p23);
+
+        float* rect = c.rect + 4 * i;
+        store_rect_sse(rect, p01, half);
+        store_rect_sse(rect + 4, _mm_movehl_ps(p01, p01), half);
+        store_rect_sse(rect + 8, p23, half);
+        store_rect_sse(rect + 12, _mm_movehl_ps(p23, p23), half);
+
+        n_expired = push_expired(dead, i, expired, n_expired);
+    }
+
+    return integrate_rows_scalar(c, i, n, dt, expired, n_expired);
+#else
+    return integrate_bullets_scalar(cols, dt, expired);
+#endif
+}
+
+size_t integrate_bullets_avx2(const BulletColumns& cols, float dt, uint32_t* expired)
+{
+#if BULLET_KERNEL_X86
+    return integrate_bullets_avx2_impl(cols, dt, expired);
+#else
+    return integrate_bullets_scalar(cols, dt, expired);
+#endif
+}
+
+bool cpu_has_sse2()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return true; // part of the x86-64 baseline
+#elif BULLET_KERNEL_X86 && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#elif BULLET_KERNEL_X86
+    return __builtin_cpu_supports("sse2");
+#else
+    return false;
+#endif
+}
+
+bool cpu_has_avx2()
+{
+#if BULLET_KERNEL_X86 && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    // AVX needs OS support for saving the ymm registers as well.
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx     = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif BULLET_KERNEL_X86
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+BulletKernel select_bullet_kernel()
+{
+    static const BulletKernel kernel = []() -> BulletKernel {
+        if (cpu_has_avx2())
+            return integrate_bullets_avx2;
+        if (cpu_has_sse2())
+            return integrate_bullets_sse;
+        return integrate_bullets_scalar;
+    }();
+    return kernel;
+}
+
+const char* bullet_kernel_name(BulletKernel kernel)
+{
+    if (kernel == integrate_bullets_avx2)
+        return "avx2";
+    if (kernel == integrate_bullets_sse)
+        return "sse";
+    return "scalar";
+}
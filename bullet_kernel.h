@@ -0,0 +1,33 @@
+#pragma once
+
+#include "net_messages.h"
+#include <cstddef>
+#include <cstdint>
+
+// One archetype column set as flecs hands it to a system. All arrays hold
+// `count` rows and are indexed by the same row.
+struct BulletColumns {
+    Position*        pos {};
+    const Direction* dir {};
+    const Speed*     speed {};
+    Range*           range {};
+    RectF*           rect {};
+    size_t           count {};
+};
+
+// Integrates every row of `cols` by `dt` and writes the row index of each
+// bullet whose range was already used up into `expired` (which must hold
+// `cols.count` entries). Returns the number of expired rows. Expired rows are
+// reported in ascending order so the caller can despawn them in one pass.
+using BulletKernel = size_t (*)(const BulletColumns& cols, float dt, uint32_t* expired);
+
+size_t integrate_bullets_scalar(const BulletColumns& cols, float dt, uint32_t* expired);
+size_t integrate_bullets_sse(const BulletColumns& cols, float dt, uint32_t* expired);
+size_t integrate_bullets_avx2(const BulletColumns& cols, float dt, uint32_t* expired);
+
+bool cpu_has_sse2();
+bool cpu_has_avx2();
+
+// Picks the widest kernel the running CPU supports. Resolved once.
+BulletKernel select_bullet_kernel();
+const char*  bullet_kernel_name(BulletKernel kernel);
@@ -1,7 +1,26 @@
 #include "game_client.h"
 
-int main() {
+#include <cstdlib>
+#include <cstring>
+
+// Usage: client [--netsim PROFILE] [--room N]
+int main(int argc, char* argv[])
+{
     GameClient client;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--netsim") && i + 1 < argc) {
+            const NetConditions* conditions = find_net_conditions(argv[++i]);
+            if (!conditions) {
+                print_net_conditions_profiles();
+                return 1;
+            }
+            client.set_net_conditions(conditions);
+        } else if (!strcmp(argv[i], "--room") && i + 1 < argc) {
+            client.set_room(static_cast<uint32_t>(atoi(argv[++i])));
+        }
+    }
+
     client.run();
     return 0;
 }
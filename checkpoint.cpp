@@ -0,0 +1,106 @@
+#include "checkpoint.h"
+#include "net_schema.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace {
+
+template <typename T>
+void append(std::vector<uint8_t>& out, const T& value)
+{
+    size_t offset = out.size();
+    out.resize(offset + sizeof(T));
+    memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+template <typename T>
+bool take(const std::vector<uint8_t>& in, size_t& offset, T& value)
+{
+    if (offset + sizeof(T) > in.size())
+        return false;
+    memcpy(&value, in.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+}
+
+}
+
+bool write_checkpoint(const char* path, const std::vector<RoomCheckpoint>& rooms)
+{
+    std::vector<uint8_t> bytes;
+
+    CheckpointFileHeader header {};
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version    = CHECKPOINT_VERSION;
+    header.protocol   = PROTOCOL_HASH;
+    header.room_count = static_cast<uint32_t>(rooms.size());
+    append(bytes, header);
+
+    for (const RoomCheckpoint& room : rooms) {
+        append(bytes, RoomCheckpointHeader { room.id, room.next_player_id, room.next_bullet_key,
+                          static_cast<uint32_t>(room.players.size()) });
+        for (const CheckpointPlayer& player : room.players) {
+            append(bytes, player);
+        }
+    }
+
+    std::string tmp_path = std::string(path) + ".tmp";
+    FILE*       file     = fopen(tmp_path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    ok      = fclose(file) == 0 && ok;
+    if (!ok) {
+        remove(tmp_path.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    remove(path); // rename doesn't replace on Windows
+#endif
+    return rename(tmp_path.c_str(), path) == 0;
+}
+
+bool read_checkpoint(const char* path, std::vector<RoomCheckpoint>& rooms)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    std::vector<uint8_t> bytes;
+    uint8_t              chunk[64 * 1024];
+    size_t               n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        bytes.insert(bytes.end(), chunk, chunk + n);
+    }
+    fclose(file);
+
+    size_t               offset = 0;
+    CheckpointFileHeader header;
+    if (!take(bytes, offset, header) || memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0
+        || header.version != CHECKPOINT_VERSION || header.protocol != PROTOCOL_HASH)
+        return false;
+
+    if (header.room_count > (bytes.size() - offset) / sizeof(RoomCheckpointHeader))
+        return false;
+
+    rooms.clear();
+    rooms.resize(header.room_count);
+    for (RoomCheckpoint& room : rooms) {
+        RoomCheckpointHeader room_header;
+        if (!take(bytes, offset, room_header) || room_header.player_count > (bytes.size() - offset) / sizeof(CheckpointPlayer))
+            return false;
+
+        room.id              = room_header.id;
+        room.next_player_id  = room_header.next_player_id;
+        room.next_bullet_key = room_header.next_bullet_key;
+        room.players.resize(room_header.player_count);
+        for (CheckpointPlayer& player : room.players) {
+            take(bytes, offset, player);
+            player.client.nick[sizeof(player.client.nick) - 1] = '\0';
+        }
+    }
+    return offset == bytes.size();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "net_messages.h"
+
+#include <cstdint>
+#include <vector>
+
+// Server state that outlives a restart: each room's counters and players.
+// Connections don't survive, so players are restored as reservations that
+// a reconnecting client claims by sending its old id and the token it was
+// given in MsgPlayerIdAssign back in MsgPlayerJoined.
+//
+// The file is a header followed, per room, by a RoomCheckpointHeader and
+// `player_count` CheckpointPlayers. It's written next to the target and renamed
+// over it, so a crash mid-write leaves the previous checkpoint intact.
+
+constexpr char     CHECKPOINT_MAGIC[4] = { 'C', 'P', 'C', 'K' };
+constexpr uint16_t CHECKPOINT_VERSION  = 2;
+
+#pragma pack(push, 1)
+struct CheckpointFileHeader {
+    char     magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t protocol; // PROTOCOL_HASH of the writer, Client layout included
+    uint32_t room_count;
+};
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+struct RoomCheckpointHeader {
+    uint32_t id;
+    uint32_t next_player_id;
+    uint64_t next_bullet_key;
+    uint32_t player_count;
+};
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+struct CheckpointPlayer {
+    Client   client;
+    uint64_t token; // reconnect token, see MsgPlayerIdAssign
+};
+#pragma pack(pop)
+
+struct RoomCheckpoint {
+    uint32_t                      id {};
+    uint32_t                      next_player_id {};
+    uint64_t                      next_bullet_key {};
+    std::vector<CheckpointPlayer> players;
+};
+
+bool write_checkpoint(const char* path, const std::vector<RoomCheckpoint>& rooms);
+
+// False if the file is missing, truncated, or from another protocol.
+bool read_checkpoint(const char* path, std::vector<RoomCheckpoint>& rooms);
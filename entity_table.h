@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Values indexed directly by server-assigned id. Ids are small and handed
+// out in order, so a flat vector beats hashing and a snapshot applies as a
+// walk over contiguous slots. Lookups of ids that were never inserted (or
+// were erased) miss explicitly instead of creating an entry.
+//
+// The table is as long as the highest id seen. Rooms hand ids out counting
+// up, and only go back to freed ones once they reach MAX_ID (see
+// GameRoom::next_player_id), so it stays within MAX_ID slots.
+template <typename T>
+class EntityTable {
+public:
+    // Ids past this are treated as misses rather than growing the table.
+    static constexpr uint32_t MAX_ID = 1u << 20;
+
+    // Inserts or replaces. False if the id is out of range.
+    bool insert_or_assign(uint32_t id, T value)
+    {
+        if (id >= MAX_ID)
+            return false;
+        if (id >= m_slots.size()) {
+            m_slots.resize(id + 1);
+        }
+
+        Slot& slot = m_slots[id];
+        if (!slot.live) {
+            slot.live = true;
+            ++m_size;
+        }
+        slot.value = std::move(value);
+        return true;
+    }
+
+    bool erase(uint32_t id)
+    {
+        if (!contains(id))
+            return false;
+
+        Slot& slot = m_slots[id];
+        slot.value = T {};
+        slot.live  = false;
+        --m_size;
+        return true;
+    }
+
+    bool contains(uint32_t id) const
+    {
+        return id < m_slots.size() && m_slots[id].live;
+    }
+
+    T* find(uint32_t id)
+    {
+        return contains(id) ? &m_slots[id].value : nullptr;
+    }
+
+    // Calls fn(value, update) for every update whose `id` is live; returns
+    // how many missed.
+    template <typename Updates, typename Fn>
+    size_t apply(const Updates& updates, Fn&& fn)
+    {
+        size_t misses = 0;
+        for (const auto& update : updates) {
+            uint32_t id = update.id;
+            if (id < m_slots.size() && m_slots[id].live) {
+                fn(m_slots[id].value, update);
+            } else {
+                ++misses;
+            }
+        }
+        return misses;
+    }
+
+    template <typename Fn>
+    void for_each(Fn&& fn)
+    {
+        for (uint32_t id = 0; id < m_slots.size(); ++id) {
+            if (m_slots[id].live)
+                fn(id, m_slots[id].value);
+        }
+    }
+
+    void clear()
+    {
+        for (Slot& slot : m_slots) {
+            if (slot.live) {
+                slot.value = T {};
+                slot.live  = false;
+            }
+        }
+        m_size = 0;
+    }
+
+    size_t size() const { return m_size; }
+
+private:
+    struct Slot {
+        T    value {};
+        bool live {};
+    };
+
+    std::vector<Slot> m_slots;
+    size_t            m_size {};
+};
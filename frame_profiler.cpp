@@ -0,0 +1,245 @@
+#include "frame_profiler.h"
+#include "net_messages.h"
+
+#include <SDL3/SDL_timer.h>
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+constexpr const char* STAGE_NAMES[] = {
+    "physics",
+    "keyboard",
+    "network",
+    "events",
+    "render",
+    "present",
+};
+static_assert(std::size(STAGE_NAMES) == static_cast<size_t>(FrameStage::Count));
+
+constexpr float GRAPH_MAX_MS   = 33.3f;
+constexpr float GRAPH_HEIGHT   = 100.0f;
+constexpr float GRAPH_STEP     = 2.0f; // pixels per frame
+constexpr float TEXT_SCALE     = 0.5f;
+constexpr int   MAX_TEXT_ROWS  = 8; // per section
+constexpr float TEXT_REFRESH_S = 0.5f;
+
+double elapsed_ms(uint64_t from, uint64_t to)
+{
+    return static_cast<double>(to - from) * 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+struct Percentiles {
+    float p50 {};
+    float p99 {};
+    float max {};
+};
+
+Percentiles percentiles(const float* samples, int count)
+{
+    if (count == 0)
+        return {};
+
+    std::vector<float> sorted(samples, samples + count);
+    std::sort(sorted.begin(), sorted.end());
+    return { sorted[count / 2], sorted[std::min(count - 1, count * 99 / 100)], sorted.back() };
+}
+
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    clear_text();
+}
+
+void FrameProfiler::toggle(flecs::world& ecs)
+{
+    m_visible = !m_visible;
+
+    // flecs only measures per-system time when asked to.
+    ecs_measure_system_time(ecs, m_visible);
+
+    if (m_visible && !m_queries_built) {
+        m_systems_query   = ecs.query_builder().with(flecs::System).build();
+        m_archetype_query = ecs.query_builder().with<Position>().build();
+        m_queries_built   = true;
+    }
+    m_last_text_update      = 0;
+    m_last_archetype_sample = 0;
+}
+
+void FrameProfiler::begin_frame()
+{
+    m_frame_start = SDL_GetPerformanceCounter();
+    for (auto& stage : m_stage_ms) {
+        stage[m_cursor] = 0.0f;
+    }
+}
+
+void FrameProfiler::end_frame(flecs::world& ecs)
+{
+    m_frame_ms[m_cursor] = static_cast<float>(elapsed_ms(m_frame_start, SDL_GetPerformanceCounter()));
+
+    if (m_visible) {
+        sample_systems(ecs);
+
+        uint64_t now = SDL_GetPerformanceCounter();
+        if (m_last_archetype_sample == 0 || elapsed_ms(m_last_archetype_sample, now) > TEXT_REFRESH_S * 1000.0) {
+            sample_archetypes(ecs);
+            m_last_archetype_sample = now;
+        }
+    }
+
+    m_cursor = (m_cursor + 1) % HISTORY;
+    m_filled = std::min(m_filled + 1, HISTORY);
+}
+
+void FrameProfiler::stage_begin(FrameStage stage)
+{
+    m_stage_start[static_cast<size_t>(stage)] = SDL_GetPerformanceCounter();
+}
+
+void FrameProfiler::stage_end(FrameStage stage)
+{
+    size_t s = static_cast<size_t>(stage);
+    m_stage_ms[s][m_cursor] += static_cast<float>(elapsed_ms(m_stage_start[s], SDL_GetPerformanceCounter()));
+}
+
+void FrameProfiler::sample_systems(flecs::world& ecs)
+{
+    m_systems_query.each([&](flecs::entity e) {
+        const ecs_system_t* system = ecs_system_get(ecs, e);
+        if (!system)
+            return;
+
+        auto it = std::find_if(m_systems.begin(), m_systems.end(),
+            [&](const SystemTime& t) { return t.id == e.id(); });
+        if (it == m_systems.end()) {
+            const char* name = e.name().c_str();
+            m_systems.push_back({ e.id(), name && *name ? name : std::to_string(e.id()), system->time_spent, 0.0 });
+            return;
+        }
+
+        // time_spent is a running total in seconds.
+        it->frame_ms   = (system->time_spent - it->last_total) * 1000.0;
+        it->last_total = system->time_spent;
+    });
+}
+
+void FrameProfiler::sample_archetypes(flecs::world& ecs)
+{
+    m_archetypes.clear();
+    m_archetype_query.run([&](flecs::iter& it) {
+        while (it.next()) {
+            m_archetypes.emplace_back(it.type().str().c_str(), static_cast<int32_t>(it.count()));
+        }
+    });
+
+    std::sort(m_archetypes.begin(), m_archetypes.end(),
+        [](const auto& a, const auto& b) { return a.second > b.second; });
+}
+
+void FrameProfiler::clear_text()
+{
+    for (SDL_Texture* texture : m_text) {
+        SDL_DestroyTexture(texture);
+    }
+    m_text.clear();
+}
+
+void FrameProfiler::rebuild_text(SDL_Renderer* renderer, TTF_Font* font)
+{
+    std::vector<std::string> lines;
+    char                     line[256];
+
+    Percentiles frame = percentiles(m_frame_ms.data(), m_filled);
+    snprintf(line, sizeof(line), "frame    p50 %6.2f  p99 %6.2f  max %6.2f ms  (%.0f fps)",
+        frame.p50, frame.p99, frame.max, frame.p50 > 0.0f ? 1000.0f / frame.p50 : 0.0f);
+    lines.emplace_back(line);
+
+    for (size_t s = 0; s < static_cast<size_t>(FrameStage::Count); ++s) {
+        Percentiles stage = percentiles(m_stage_ms[s].data(), m_filled);
+        snprintf(line, sizeof(line), "%-8s p50 %6.2f  p99 %6.2f  max %6.2f ms",
+            STAGE_NAMES[s], stage.p50, stage.p99, stage.max);
+        lines.emplace_back(line);
+    }
+
+    std::vector<SystemTime> systems = m_systems;
+    std::sort(systems.begin(), systems.end(),
+        [](const SystemTime& a, const SystemTime& b) { return a.frame_ms > b.frame_ms; });
+
+    lines.emplace_back("systems (last frame)");
+    for (size_t i = 0; i < systems.size() && i < MAX_TEXT_ROWS; ++i) {
+        snprintf(line, sizeof(line), "  %7.3f ms  %s", systems[i].frame_ms, systems[i].name.c_str());
+        lines.emplace_back(line);
+    }
+
+    lines.emplace_back("archetypes");
+    for (size_t i = 0; i < m_archetypes.size() && i < MAX_TEXT_ROWS; ++i) {
+        snprintf(line, sizeof(line), "  %7d  %s", m_archetypes[i].second, m_archetypes[i].first.c_str());
+        lines.emplace_back(line);
+    }
+
+    clear_text();
+    SDL_Color white = { 255, 255, 255, 255 };
+    for (const std::string& text : lines) {
+        SDL_Surface* surf = TTF_RenderText_Blended(font, text.c_str(), 0, white);
+        if (!surf)
+            continue;
+        m_text.push_back(SDL_CreateTextureFromSurface(renderer, surf));
+        SDL_DestroySurface(surf);
+    }
+}
+
+void FrameProfiler::render(SDL_Renderer* renderer, TTF_Font* font, int window_w, int window_h)
+{
+    if (!m_visible)
+        return;
+
+    uint64_t now = SDL_GetPerformanceCounter();
+    if (font && (m_last_text_update == 0 || elapsed_ms(m_last_text_update, now) > TEXT_REFRESH_S * 1000.0)) {
+        rebuild_text(renderer, font);
+        m_last_text_update = now;
+    }
+
+    Uint8         r, g, b, a;
+    SDL_BlendMode blend;
+    SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+    SDL_GetRenderDrawBlendMode(renderer, &blend);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    const float graph_w = HISTORY * GRAPH_STEP;
+    const float left    = window_w - graph_w - 20.0f;
+    const float top     = 10.0f;
+
+    SDL_FRect panel { left - 10.0f, top, graph_w + 20.0f, static_cast<float>(window_h) - 2.0f * top };
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 180);
+    SDL_RenderFillRect(renderer, &panel);
+
+    // 16.6 ms budget line
+    float budget_y = top + GRAPH_HEIGHT - GRAPH_HEIGHT * (16.6f / GRAPH_MAX_MS);
+    SDL_SetRenderDrawColor(renderer, 80, 160, 80, 255);
+    SDL_RenderLine(renderer, left, budget_y, left + graph_w, budget_y);
+
+    SDL_FPoint points[HISTORY];
+    int        oldest = (m_cursor - m_filled + HISTORY) % HISTORY;
+    for (int i = 0; i < m_filled; ++i) {
+        float ms  = std::min(m_frame_ms[(oldest + i) % HISTORY], GRAPH_MAX_MS);
+        points[i] = { left + i * GRAPH_STEP, top + GRAPH_HEIGHT - GRAPH_HEIGHT * (ms / GRAPH_MAX_MS) };
+    }
+    SDL_SetRenderDrawColor(renderer, 240, 200, 60, 255);
+    SDL_RenderLines(renderer, points, m_filled);
+
+    float y = top + GRAPH_HEIGHT + 10.0f;
+    for (SDL_Texture* texture : m_text) {
+        SDL_FRect dst { left, y, 0.0f, 0.0f };
+        SDL_GetTextureSize(texture, &dst.w, &dst.h);
+        dst.w *= TEXT_SCALE;
+        dst.h *= TEXT_SCALE;
+        SDL_RenderTexture(renderer, texture, nullptr, &dst);
+        y += dst.h;
+    }
+
+    SDL_SetRenderDrawBlendMode(renderer, blend);
+    SDL_SetRenderDrawColor(renderer, r, g, b, a);
+}
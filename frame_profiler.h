@@ -0,0 +1,73 @@
+#pragma once
+
+#include <SDL3/SDL_render.h>
+#include <SDL3_ttf/SDL_ttf.h>
+#include <array>
+#include <cstdint>
+#include <flecs.h>
+#include <string>
+#include <vector>
+
+enum class FrameStage : uint8_t {
+    Physics,
+    Keyboard,
+    Network,
+    Events,
+    Render,
+    Present,
+    Count
+};
+
+// Collects per-stage frame timings and draws them as an overlay. Stage
+// timings are always collected (two counter reads per stage); the flecs
+// system timings, archetype counts and text are only gathered while the
+// overlay is visible.
+class FrameProfiler {
+public:
+    static constexpr int HISTORY = 240; // frames kept for the graph and percentiles
+
+    ~FrameProfiler();
+
+    void toggle(flecs::world& ecs);
+    bool is_visible() const { return m_visible; }
+
+    void begin_frame();
+    void end_frame(flecs::world& ecs);
+
+    void stage_begin(FrameStage stage);
+    void stage_end(FrameStage stage);
+
+    void render(SDL_Renderer* renderer, TTF_Font* font, int window_w, int window_h);
+    void clear_text(); // releases the cached text textures
+
+private:
+    struct SystemTime {
+        flecs::entity_t id {};
+        std::string     name;
+        double          last_total {};
+        double          frame_ms {};
+    };
+
+    void sample_systems(flecs::world& ecs);
+    void sample_archetypes(flecs::world& ecs);
+    void rebuild_text(SDL_Renderer* renderer, TTF_Font* font);
+
+    bool     m_visible {};
+    bool     m_queries_built {};
+    uint64_t m_frame_start {};
+    uint64_t m_last_text_update {};
+    uint64_t m_last_archetype_sample {};
+    int      m_cursor {};
+    int      m_filled {};
+
+    std::array<uint64_t, static_cast<size_t>(FrameStage::Count)>                    m_stage_start {};
+    std::array<std::array<float, HISTORY>, static_cast<size_t>(FrameStage::Count)> m_stage_ms {};
+    std::array<float, HISTORY>                                                      m_frame_ms {};
+
+    flecs::query<>                               m_systems_query;
+    flecs::query<>                               m_archetype_query;
+    std::vector<SystemTime>                      m_systems;
+    std::vector<std::pair<std::string, int32_t>> m_archetypes;
+
+    std::vector<SDL_Texture*> m_text;
+};
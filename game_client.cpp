@@ -1,6 +1,8 @@
 #include "game_client.h"
 #include "net_messages.h"
+#include "net_schema.h"
 #include "network_utils.h"
+#include "roster.h"
 
 #include <cassert>
 #include <cstdarg>
@@ -32,6 +34,7 @@ void GameClient::poll_loop()
         poll_incoming_messages();
         poll_connection_state_changes();
         poll_local_user_input();
+        flush_outbound();
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
 
@@ -40,6 +43,8 @@ void GameClient::poll_loop()
 
 void GameClient::connect()
 {
+    stop_network_thread(); // left running if the peer closed on us
+
     m_sockets = SteamNetworkingSockets();
     if (m_sockets == nullptr) {
         fatal_error("Failed to create net socket.");
@@ -67,23 +72,121 @@ void GameClient::connect()
         fatal_error("Failed to create connection.");
     }
 
-    m_is_connected = true;
+    if (m_recorder) {
+        m_recorder->record(RecordKind::Connected, m_net_connection);
+    }
+
+    // Queued until the connection is up; reliable ordering keeps it first.
+    uint8_t hello[encoded_message_size<MsgHello>()];
+    send_data(hello, encode_message(MsgHello { PROTOCOL_HASH }, hello, sizeof(hello)),
+        k_nSteamNetworkingSend_Reliable);
+
+    uint8_t join[encoded_message_size<MsgJoinRoom>()];
+    send_data(join, encode_message(MsgJoinRoom { m_room }, join, sizeof(join)),
+        k_nSteamNetworkingSend_Reliable);
+
+    if (m_use_network_thread) {
+        m_network_running = true; // before the thread can look at it
+        m_network_thread  = std::jthread([this](std::stop_token stop) { network_loop(stop); });
+    }
+}
+
+GameClient::ConnectAwaiter GameClient::connect_async()
+{
+    connect();
+    return ConnectAwaiter(*this);
+}
+
+void GameClient::EventAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    m_waiter.handle = handle;
+    if (m_client.m_net_connection == k_HSteamNetConnection_Invalid) {
+        m_client.m_ready.push_back(handle); // nothing will ever answer
+        return;
+    }
+
+    m_client.m_waiters.push_back(&m_waiter);
+    if (!m_request.empty()) {
+        m_client.queue_data(m_request.data(), static_cast<uint32>(m_request.size()), m_request_flag);
+        m_client.flush_outbound();
+    }
+}
+
+std::optional<NetEvent> GameClient::EventAwaiter::await_resume()
+{
+    if (!m_waiter.ok)
+        return std::nullopt;
+    return std::move(m_waiter.event);
+}
+
+void GameClient::poll()
+{
+    if (m_sockets && !m_network_running) {
+        poll_connection_state_changes();
+    }
+    parse_incoming_messages();
+    resume_ready();
+}
+
+void GameClient::resolve_waiters(const NetEvent& event)
+{
+    for (size_t i = 0; i < m_waiters.size();) {
+        Waiter* waiter = m_waiters[i];
+        bool    match  = waiter->kind == event.kind;
+        if (!match && event.kind != NetEventKind::Disconnected) {
+            ++i;
+            continue;
+        }
+
+        waiter->ok = match;
+        if (match) {
+            waiter->event = event;
+        }
+        m_ready.push_back(waiter->handle);
+        m_waiters[i] = m_waiters.back();
+        m_waiters.pop_back();
+    }
+}
+
+// Outside of dispatch, so a resumed coroutine can await again or send
+// without re-entering the receive path.
+void GameClient::resume_ready()
+{
+    while (!m_ready.empty()) {
+        std::vector<std::coroutine_handle<>> ready;
+        ready.swap(m_ready);
+        for (std::coroutine_handle<> handle : ready) {
+            handle.resume();
+        }
+    }
 }
 
 void GameClient::disconnect_from_server()
 {
+    flush_outbound(); // the goodbye is usually still queued
+    stop_network_thread();
 
     if (m_net_connection != k_HSteamNetConnection_Invalid) {
+        if (m_recorder) {
+            m_recorder->record(RecordKind::Disconnected, m_net_connection);
+        }
         m_sockets->CloseConnection(m_net_connection, 0, "Client disconnecting.", true);
         m_net_connection = k_HSteamNetConnection_Invalid;
     }
     m_is_connected = false;
     m_is_quitting  = true;
+
+    // Whoever was waiting on this connection gives up on the next poll().
+    NetEvent closed;
+    closed.kind = NetEventKind::Disconnected;
+    resolve_waiters(closed);
     // GameNetworkingSockets_Kill();
 }
 
 void GameClient::shutdown()
 {
+    stop_network_thread();
+
     // Step 5: destroy the library
     if (m_net_connection != k_HSteamNetConnection_Invalid) {
         m_sockets->CloseConnection(m_net_connection, 0, nullptr, false);
@@ -91,6 +194,9 @@ void GameClient::shutdown()
     }
     m_is_connected = false;
     m_is_quitting  = true;
+    if (m_recorder) {
+        m_recorder->close(); // the process is killed below, flush first
+    }
     GameNetworkingSockets_Kill();
     nuke_process(0);
 }
@@ -115,43 +221,167 @@ void GameClient::poll_incoming_messages()
 
 void GameClient::parse_incoming_messages()
 {
-    ISteamNetworkingMessage* msg      = nullptr;
-    int                      num_msgs = m_sockets->ReceiveMessagesOnConnection(m_net_connection, &msg, 1);
-    if (num_msgs == 0)
+    if (m_network_running) {
+        while (m_inbound_events.pop([this](const NetEvent& event) { dispatch_event(event); })) {
+        }
         return;
-    if (num_msgs < 0)
-        fatal_error("Client received Error checking messages.");
+    }
+    receive_messages();
+}
 
-    int   size = msg->m_cbSize;
-    void* data = msg->m_pData;
+void GameClient::receive_messages()
+{
+    while (m_net_connection != k_HSteamNetConnection_Invalid) {
+        ISteamNetworkingMessage* msg      = nullptr;
+        int                      num_msgs = m_sockets->ReceiveMessagesOnConnection(m_net_connection, &msg, 1);
+        if (num_msgs == 0)
+            break;
+        if (num_msgs < 0) {
+            fatal_error("Client received Error checking messages.");
+            break;
+        }
 
-    if (size < sizeof(MsgHeader)) {
+        handle_message((const uint8_t*)msg->m_pData, msg->m_cbSize);
         msg->Release();
-        fatal_error("Client received Invalid packet (too small)\n");
     }
+}
 
-    MsgHeader header;
-    memcpy(&header, data, sizeof(header));
+void GameClient::handle_message(const uint8_t* data, uint32 size)
+{
+    if (m_recorder) {
+        m_recorder->record(RecordKind::Received, m_net_connection, data, size);
+    }
 
-    if (size < sizeof(MsgHeader) + header.size) {
-        msg->Release();
-        printt("Conn: %u\n", msg->m_conn);
+    MsgHeader header;
+    if (!decode_header(data, size, header)) {
         printt("Header type: %d\n", header.type);
         printt("Client received Malformed packet (wrong size)\n");
         return;
     }
 
-    uint8_t* payload = (uint8_t*)data + sizeof(MsgHeader);
+    const uint8_t* payload = data + MSG_HEADER_SIZE;
+
+    if (header.type == MsgType::Batch) {
+        bool ok = for_each_batch_record(payload, header.size, [&](const MsgHeader& record, const uint8_t* record_payload) {
+            handle_record(record, record_payload);
+            return true;
+        });
+        if (!ok) {
+            printt("Client received Malformed batch\n");
+        }
+    } else {
+        handle_record(header, payload);
+    }
+
+    // A server batch is one tick's worth of updates, applied together.
+    if (!m_position_updates.empty()) {
+        deliver([&](NetEvent& event) {
+            event.kind = NetEventKind::PositionsChanged;
+            event.positions.swap(m_position_updates);
+        });
+        m_position_updates.clear();
+    }
+}
+
+template <typename Fill>
+void GameClient::deliver(Fill&& fill)
+{
+    if (!m_network_running) {
+        fill(m_event);
+        dispatch_event(m_event);
+        return;
+    }
+
+    if (m_overflow_events.empty() && m_overflow_positions.empty() && m_inbound_events.push(fill))
+        return;
+
+    // The game thread has stalled for a thousand events. Bullets came
+    // unreliably and are gone in a moment, so they go. Positions collapse
+    // to the latest per player, which still lands after the rest; a player
+    // who stopped must not be left where an older update put them.
+    // Everything else waits its turn here, in order, without holding up
+    // the network thread.
+    NetEvent event;
+    fill(event);
+    if (event.kind == NetEventKind::SpawnBullet) {
+        ++m_events_dropped;
+        return;
+    }
+    if (event.kind == NetEventKind::PositionsChanged) {
+        for (const MsgPlayerPositionChanged& update : event.positions) {
+            m_overflow_positions[update.id] = update.position;
+        }
+    } else {
+        m_overflow_events.push_back(std::move(event));
+    }
+    push_overflow_events();
+}
+
+void GameClient::push_overflow_events()
+{
+    while (!m_overflow_events.empty() && m_inbound_events.push([this](NetEvent& slot) {
+        slot = std::move(m_overflow_events.front());
+    })) {
+        m_overflow_events.pop_front();
+    }
+    if (!m_overflow_events.empty() || m_overflow_positions.empty())
+        return;
 
+    bool pushed = m_inbound_events.push([this](NetEvent& slot) {
+        slot.kind = NetEventKind::PositionsChanged;
+        slot.positions.clear();
+        for (const auto& [id, position] : m_overflow_positions) {
+            slot.positions.push_back({ id, position });
+        }
+    });
+    if (pushed) {
+        m_overflow_positions.clear();
+    }
+}
+
+void GameClient::dispatch_event(const NetEvent& event)
+{
+    resolve_waiters(event);
+
+    switch (event.kind) {
+    case NetEventKind::Connected:
+        break;
+    case NetEventKind::Disconnected:
+        if (on_disconnected) {
+            on_disconnected();
+        }
+        break;
+    case NetEventKind::PlayerJoined:
+        on_player_joined(event.id, event.pos);
+        break;
+    case NetEventKind::PlayerLeft:
+        on_player_left(event.id);
+        break;
+    case NetEventKind::PlayerIdAssigned:
+        m_reconnect_token = event.token;
+        on_player_id_assigned(event.id);
+        break;
+    case NetEventKind::PositionsChanged:
+        on_player_positions_changed(event.positions);
+        break;
+    case NetEventKind::InitialState:
+        on_players_initial_state_sent(event.clients);
+        break;
+    case NetEventKind::SpawnBullet:
+        on_players_spawn_bullet(event.bullet);
+        break;
+    }
+}
+
+void GameClient::handle_record(const MsgHeader& header, const uint8_t* payload)
+{
     switch (header.type) {
     case MsgType::Direction: {
-        if (header.size != sizeof(Direction)) {
+        Direction dir;
+        if (!decode_payload(payload, header.size, dir)) {
             printt("Client received Invalid Direction packet size\n");
             break;
         }
-
-        Direction dir;
-        memcpy(&dir, payload, sizeof(dir));
         // printt("Direction x=%f y=%f\n", dir.x, dir.y);
     } break;
 
@@ -162,93 +392,96 @@ void GameClient::parse_incoming_messages()
     } break;
 
     case MsgType::Position: {
-        if (header.size != sizeof(Position)) {
+        Position pos;
+        if (!decode_payload(payload, header.size, pos)) {
             printt("Client received Invalid Position packet size\n");
             break;
         }
-
-        Position pos;
-        memcpy(&pos, payload, sizeof(pos));
         printt("Position x=%f y=%f\n", pos.x, pos.y);
 
     } break;
 
     case MsgType::MsgPlayerJoined: {
-        if (header.size != sizeof(MsgPlayerJoined)) {
+        MsgPlayerJoined joined_msg;
+        if (!decode_payload(payload, header.size, joined_msg)) {
             printt("Client received Invalid MsgPlayerJoined packet size\n");
             break;
         }
-
-        MsgPlayerJoined joined_msg;
-        memcpy(&joined_msg, payload, sizeof(joined_msg));
-        on_player_joined(joined_msg.id, joined_msg.position);
+        deliver([&](NetEvent& event) {
+            event.kind = NetEventKind::PlayerJoined;
+            event.id   = joined_msg.id;
+            event.pos  = joined_msg.position;
+        });
 
         printt("Player '%d' joined x=%f y=%f\n",
             joined_msg.id, joined_msg.position.x, joined_msg.position.x);
     } break;
 
     case MsgType::MsgPlayerLeft: {
-        if (header.size != sizeof(MsgPlayerLeft)) {
+        MsgPlayerLeft left_msg;
+        if (!decode_payload(payload, header.size, left_msg)) {
             printt("Client received Invalid MsgPlayerLeft packet size\n");
             break;
         }
-
-        MsgPlayerLeft left_msg;
-        memcpy(&left_msg, payload, sizeof(left_msg));
-        on_player_left(left_msg.id);
+        deliver([&](NetEvent& event) {
+            event.kind = NetEventKind::PlayerLeft;
+            event.id   = left_msg.id;
+        });
 
         printt("Player '%d' left.\n", left_msg.id);
     } break;
 
     case MsgType::MsgPlayerIdAssign: {
-        if (header.size != sizeof(MsgPlayerIdAssign)) {
+        MsgPlayerIdAssign id_assign_msg;
+        if (!decode_payload(payload, header.size, id_assign_msg)) {
             printt("Client received Invalid MsgPlayerIdAssign packet size\n");
             break;
         }
-
-        MsgPlayerIdAssign id_assign_msg;
-        memcpy(&id_assign_msg, payload, sizeof(id_assign_msg));
-        on_player_id_assigned(id_assign_msg.id);
+        deliver([&](NetEvent& event) {
+            event.kind  = NetEventKind::PlayerIdAssigned;
+            event.id    = id_assign_msg.id;
+            event.token = id_assign_msg.token;
+        });
 
         printt("Player assigned id '%d'.\n", id_assign_msg.id);
     } break;
 
     case MsgType::MsgPlayerPositionChanged: {
-        if (header.size != sizeof(MsgPlayerPositionChanged)) {
+        MsgPlayerPositionChanged position_changed_msg;
+        if (!decode_payload(payload, header.size, position_changed_msg)) {
             printt("Client received Invalid MsgPlayerPositionChanged packet size\n");
             break;
         }
-
-        MsgPlayerPositionChanged position_changed_msg;
-        memcpy(&position_changed_msg, payload, sizeof(position_changed_msg));
-        on_player_position_changed(position_changed_msg.id, position_changed_msg.position);
+        m_position_updates.push_back(position_changed_msg);
 
         // printt("Player '%d' position changed x: '%f' y: '%f'.\n",
         //     position_changed_msg.id, position_changed_msg.position.x, position_changed_msg.position.y);
     } break;
 
     case MsgType::MsgInitialState: {
-        if (header.size != sizeof(MsgInitialState)) {
+        std::vector<Client> clients;
+        if (!decode_roster(payload, header.size, clients)) {
             printt("Client received Invalid MsgInitialState packet size\n");
             break;
         }
-
-        MsgInitialState position_changed_msg;
-        memcpy(&position_changed_msg, payload, sizeof(position_changed_msg));
-        on_players_initial_state_sent(position_changed_msg.count, position_changed_msg.clients);
+        deliver([&](NetEvent& event) {
+            event.kind = NetEventKind::InitialState;
+            event.clients.swap(clients);
+        });
 
     } break;
 
     case MsgType::MsgSpawnBullet: {
-            if (header.size != sizeof(MsgSpawnBullet)) {
+            MsgSpawnBullet spawn_bullet_msg;
+            if (!decode_payload(payload, header.size, spawn_bullet_msg)) {
                 printt("Client received Invalid MsgSpawnBullet packet size\n");
                 break;
             }
 
-            MsgSpawnBullet spawn_bullet_msg;
-            memcpy(&spawn_bullet_msg, payload, sizeof(spawn_bullet_msg));
-
-            on_players_spawn_bullet(spawn_bullet_msg);
+            deliver([&](NetEvent& event) {
+                event.kind   = NetEventKind::SpawnBullet;
+                event.bullet = spawn_bullet_msg;
+            });
             // printt("Player '%d' position changed x: '%f' y: '%f'.\n",
             //     spawn_bullet_msg.id, spawn_bullet_msg.position.x, spawn_bullet_msg.position.y);
         } break;
@@ -257,10 +490,6 @@ void GameClient::parse_incoming_messages()
         printt("Client received Unknown message type\n");
     }
 
-    // fwrite(msg->m_pData, 1, msg->m_cbSize, stdout);
-    // fputc('\n', stdout);
-
-    msg->Release();
 }
 
 void GameClient::init()
@@ -273,6 +502,10 @@ void GameClient::init()
     g_logTimeZero = SteamNetworkingUtils()->GetLocalTimestamp();
     SteamNetworkingUtils()->SetDebugOutputFunction(k_ESteamNetworkingSocketsDebugOutputType_Msg, debug_output);
 
+    if (m_net_conditions) {
+        apply_net_conditions(*m_net_conditions);
+    }
+
     local_user_input_init();
 }
 
@@ -302,24 +535,139 @@ void GameClient::send_string_data_to_server(std::string_view msg)
 {
     MsgHeader header;
     header.type = MsgType::ChatMessage;
-    header.size = static_cast<uint32_t>(msg.size());
+    header.size = static_cast<uint16_t>(msg.size());
 
-    std::vector<uint8_t> buffer(sizeof(MsgHeader) + msg.size());
+    std::vector<uint8_t> buffer(MSG_HEADER_SIZE + msg.size());
 
-    memcpy(buffer.data(), &header, sizeof(MsgHeader));
-    memcpy(buffer.data() + sizeof(MsgHeader), msg.data(), msg.size());
+    NetWriter writer(buffer.data(), buffer.size());
+    net_schema::write(writer, header);
+    writer.raw(msg.data(), msg.size());
 
-    m_sockets->SendMessageToConnection(m_net_connection, buffer.data(),
-        buffer.size(), k_nSteamNetworkingSend_Reliable,
-        nullptr);
+    queue_data(buffer.data(), buffer.size(), k_nSteamNetworkingSend_Reliable);
 }
 
 void GameClient::send_data(const void* data, uint32 data_size, int k_n_flag)
 {
+    if (m_recorder) {
+        m_recorder->record(RecordKind::Sent, m_net_connection, data, data_size);
+    }
+
     m_sockets->SendMessageToConnection(m_net_connection, data,
         data_size, k_n_flag, nullptr);
 }
 
+void GameClient::queue_data(const void* data, uint32 data_size, int k_n_flag)
+{
+    if (!m_network_running) {
+        batch_data(data, data_size, k_n_flag);
+        return;
+    }
+
+    auto fill = [&](Outbound& out) {
+        out.flush = false;
+        out.flag  = k_n_flag;
+        out.data.assign((const uint8_t*)data, (const uint8_t*)data + data_size);
+    };
+    while (!m_outbound_messages.push(fill)) {
+        std::this_thread::yield(); // the network thread drains every millisecond
+    }
+}
+
+void GameClient::batch_data(const void* data, uint32 data_size, int k_n_flag)
+{
+    bool          reliable = k_n_flag & k_nSteamNetworkingSend_Reliable;
+    MessageBatch& batch    = reliable ? m_reliable_batch : m_unreliable_batch;
+
+    if (batch.append((const uint8_t*)data, data_size))
+        return;
+
+    flush_batch(batch, k_n_flag);
+    if (!batch.append((const uint8_t*)data, data_size)) {
+        send_data(data, data_size, k_n_flag); // bigger than a batch on its own
+    }
+}
+
+void GameClient::flush_outbound()
+{
+    if (!m_network_running) {
+        flush_batches();
+        return;
+    }
+
+    // Marks the end of the frame, so the network thread sends what the
+    // frame queued together as it would have inline.
+    while (!m_outbound_messages.push([](Outbound& out) { out.flush = true; })) {
+        std::this_thread::yield();
+    }
+}
+
+void GameClient::flush_batches()
+{
+    flush_batch(m_reliable_batch, k_nSteamNetworkingSend_Reliable);
+    flush_batch(m_unreliable_batch, k_nSteamNetworkingSend_Unreliable);
+}
+
+void GameClient::drain_outbound()
+{
+    while (m_outbound_messages.pop([this](const Outbound& out) {
+        if (out.flush) {
+            flush_batches();
+        } else {
+            batch_data(out.data.data(), static_cast<uint32>(out.data.size()), out.flag);
+        }
+    })) {
+    }
+}
+
+void GameClient::network_loop(std::stop_token stop)
+{
+    while (!stop.stop_requested()) {
+        poll_connection_state_changes();
+        push_overflow_events();
+        receive_messages();
+        drain_outbound();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Whatever the game queued before asking us to stop, e.g. MsgPlayerLeft.
+    drain_outbound();
+    flush_batches();
+}
+
+void GameClient::stop_network_thread()
+{
+    if (!m_network_thread.joinable())
+        return;
+
+    m_network_thread.request_stop();
+    m_network_thread.join();
+    m_network_running = false;
+
+    // Events for a connection that is gone.
+    while (m_inbound_events.pop([](const NetEvent&) { })) {
+    }
+    m_overflow_events.clear();
+    m_overflow_positions.clear();
+    if (m_events_dropped > 0) {
+        printt("Dropped %llu bullet events the game thread had no room for\n",
+            (unsigned long long)m_events_dropped);
+        m_events_dropped = 0;
+    }
+}
+
+void GameClient::flush_batch(MessageBatch& batch, int k_n_flag)
+{
+    if (batch.empty())
+        return;
+
+    size_t         size;
+    const uint8_t* data = batch.finish(size);
+    if (m_net_connection != k_HSteamNetConnection_Invalid) {
+        send_data(data, static_cast<uint32>(size), k_n_flag);
+    }
+    batch.clear();
+}
+
 void GameClient::on_net_connection_status_changed(SteamNetConnectionStatusChangedCallback_t* p_info)
 {
     assert(p_info->m_hConn == m_net_connection || m_net_connection == k_HSteamNetConnection_Invalid);
@@ -343,6 +691,8 @@ void GameClient::on_net_connection_status_changed(SteamNetConnectionStatusChange
 
         m_sockets->CloseConnection(m_net_connection, 0, nullptr, false);
         m_net_connection = k_HSteamNetConnection_Invalid;
+        m_is_connected   = false;
+        deliver([](NetEvent& event) { event.kind = NetEventKind::Disconnected; });
         break;
     }
 
@@ -352,6 +702,7 @@ void GameClient::on_net_connection_status_changed(SteamNetConnectionStatusChange
     case k_ESteamNetworkingConnectionState_Connected:
         m_is_connected = true;
         printt("Connected to server. OK.");
+        deliver([](NetEvent& event) { event.kind = NetEventKind::Connected; });
         break;
 
     default:
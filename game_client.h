@@ -1,16 +1,112 @@
+#include "message_batch.h"
+#include "net_conditions.h"
 #include "net_messages.h"
+#include "net_recorder.h"
+#include "spsc_ring.h"
 #include <atomic>
+#include <coroutine>
+#include <deque>
 #include <functional>
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <steam/isteamnetworkingsockets.h>
 #include <steam/steamnetworkingtypes.h>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <vector>
+
+// What handle_record decoded, as delivered to the on_* callbacks, plus
+// connection state changes for the awaitables.
+enum class NetEventKind : uint8_t {
+    Connected,
+    Disconnected,
+    PlayerJoined,
+    PlayerLeft,
+    PlayerIdAssigned,
+    PositionsChanged,
+    InitialState,
+    SpawnBullet,
+};
+
+struct NetEvent {
+    NetEventKind                          kind {};
+    uint32_t                              id {};
+    uint64_t                              token {}; // PlayerIdAssigned
+    Position                              pos {};
+    MsgSpawnBullet                        bullet {};
+    std::vector<MsgPlayerPositionChanged> positions;
+    std::vector<Client>                   clients;
+};
 
 class GameClient {
 
+    struct Waiter {
+        NetEventKind            kind {};
+        std::coroutine_handle<> handle;
+        bool                    ok {};
+        NetEvent                event;
+    };
+
 public:
+    // co_await inside a NetTask. Resumes from poll() with the first
+    // event of `kind`, or with nothing if the connection goes down first.
+    class EventAwaiter {
+    public:
+        EventAwaiter(GameClient& client, NetEventKind kind)
+            : m_client(client)
+        {
+            m_waiter.kind = kind;
+        }
+
+        bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        std::optional<NetEvent> await_resume();
+
+    private:
+        friend class GameClient;
+
+        GameClient&          m_client;
+        Waiter               m_waiter;
+        std::vector<uint8_t> m_request; // sent once suspended, see request()
+        int                  m_request_flag {};
+    };
+
+    // Resumes with true once the connection is up, false if it failed.
+    class ConnectAwaiter {
+    public:
+        explicit ConnectAwaiter(GameClient& client)
+            : m_events(client, NetEventKind::Connected)
+        {
+        }
+
+        bool await_ready() const { return m_events.m_client.m_is_connected; }
+        void await_suspend(std::coroutine_handle<> handle) { m_events.await_suspend(handle); }
+        bool await_resume() { return m_events.m_client.m_is_connected || m_events.await_resume().has_value(); }
+
+    private:
+        EventAwaiter m_events;
+    };
+
+    // Starts connect() and waits for the handshake.
+    ConnectAwaiter connect_async();
+    EventAwaiter   await_event(NetEventKind kind) { return { *this, kind }; }
+    // Sends `msg` and waits for the event its reply turns into.
+    template <typename T>
+    EventAwaiter request(const T& msg, int k_n_flag, NetEventKind reply);
+    // MsgPlayerJoined, answered by MsgPlayerIdAssign. Rejoining with the
+    // id assigned last time reclaims it, if the server still holds it.
+    EventAwaiter join(uint32_t id, Position pos)
+    {
+        return request(MsgPlayerJoined { id, pos, m_reconnect_token }, k_nSteamNetworkingSend_Reliable,
+            NetEventKind::PlayerIdAssigned);
+    }
+
+    // Once per frame on the game thread, connected or not: connection
+    // callbacks, incoming messages, then any coroutines that can continue.
+    void poll();
+
     void init();
     void run();
     void connect();
@@ -18,36 +114,100 @@ public:
     void shutdown();
     void disconnect_from_server();
     void send_data(const void* data, uint32 data_size, int k_n_flag);
-    bool m_is_connected { false };
+    // Appends an encoded message to the outgoing batch for its reliability;
+    // nothing is sent until flush_outbound(), or until the batch fills up.
+    void queue_data(const void* data, uint32 data_size, int k_n_flag);
+    void flush_outbound(); // once per frame
+    std::atomic<bool> m_is_connected { false }; // set once the handshake completes
+    // Calls the on_* callbacks for everything received since the last call.
     void parse_incoming_messages();
+    // Before connect(): receive, batch and send on a thread of our own, so
+    // a slow frame doesn't delay acks and sends. The game thread then only
+    // trades NetEvents and encoded messages with it through SpscRings;
+    // callbacks still run on the game thread, inside parse_incoming_messages.
+    void set_network_thread(bool enabled) { m_use_network_thread = enabled; }
+    void set_recorder(NetRecorder* recorder) { m_recorder = recorder; }
+    void set_net_conditions(const NetConditions* conditions) { m_net_conditions = conditions; }
+    void set_room(uint32_t room) { m_room = room; }
 
 
-    std::function<void(uint32_t id, Position pos)> on_player_position_changed;
+    std::function<void(const std::vector<MsgPlayerPositionChanged>& updates)> on_player_positions_changed;
     std::function<void(uint32_t id, Position pos)> on_player_joined;
-    std::function<void(uint32_t id, Client clients[8])> on_players_initial_state_sent;
+    std::function<void(const std::vector<Client>& clients)> on_players_initial_state_sent;
     std::function<void(MsgSpawnBullet)> on_players_spawn_bullet;
     std::function<void(uint32_t id)> on_player_id_assigned;
     std::function<void(uint32_t id)> on_player_left;
+    std::function<void()> on_disconnected; // by the server or the network, not disconnect_from_server()
 
 
 private:
     static GameClient* m_instance;
 
-    ISteamNetworkingSockets* m_sockets;
-    HSteamNetConnection      m_net_connection;
+    ISteamNetworkingSockets*         m_sockets;
+    std::atomic<HSteamNetConnection> m_net_connection { k_HSteamNetConnection_Invalid }; // closed by the network thread, checked by awaiters
+    NetRecorder*                     m_recorder {};
+    const NetConditions*             m_net_conditions {};
+    uint32_t                         m_room {};
+    MessageBatch                     m_reliable_batch;
+    MessageBatch                     m_unreliable_batch;
 
     std::jthread            m_threadUserInput;
     std::queue<std::string> m_queueUserInput;
     std::atomic<bool>       m_is_quitting { false };
     std::mutex              m_mutexUserInputQueue;
 
+    std::vector<MsgPlayerPositionChanged> m_position_updates; // gathered per received message
+
+    // Network thread mode. The game thread pushes outbound and pops inbound;
+    // the network thread does the opposite.
+    struct Outbound {
+        bool                 flush {}; // end of a frame's messages
+        int                  flag {};
+        std::vector<uint8_t> data;
+    };
+
+    bool                     m_use_network_thread {};
+    std::atomic<bool>        m_network_running {}; // set before start, cleared after join
+    std::jthread             m_network_thread;
+    SpscRing<NetEvent, 1024> m_inbound_events;
+    SpscRing<Outbound, 256>  m_outbound_messages;
+    NetEvent                 m_event; // scratch when delivering inline
+
+    // Network thread only, while m_inbound_events is full.
+    std::deque<NetEvent>                   m_overflow_events;    // waiting for ring space, oldest first
+    std::unordered_map<uint32_t, Position> m_overflow_positions; // latest per player, after m_overflow_events
+    uint64_t                               m_events_dropped {};  // bullets
+
+    // Game thread only.
+    std::vector<Waiter*>                 m_waiters;
+    std::vector<std::coroutine_handle<>> m_ready;
+    uint64_t                             m_reconnect_token {}; // from the last MsgPlayerIdAssign
+
     void send_string_data_to_server(std::string_view msg);
+    void handle_message(const uint8_t* data, uint32 size);
+    void handle_record(const MsgHeader& header, const uint8_t* payload);
     void poll_incoming_messages();
     void poll_local_user_input();
     void local_user_input_init();
     void on_net_connection_status_changed(SteamNetConnectionStatusChangedCallback_t* p_info);
     void poll_connection_state_changes();
     bool local_user_input_get_next(std::string& result);
+    void flush_batch(MessageBatch& batch, int k_n_flag);
+    void batch_data(const void* data, uint32 data_size, int k_n_flag);
+    void flush_batches();
+    void receive_messages();
+    void network_loop(std::stop_token stop);
+    void drain_outbound();
+    void push_overflow_events();
+    void stop_network_thread();
+    void dispatch_event(const NetEvent& event);
+    void resolve_waiters(const NetEvent& event);
+    void resume_ready();
+
+    // Hands a decoded event to the game thread: straight to the callbacks,
+    // or through m_inbound_events when the network thread is running.
+    template <typename Fill>
+    void deliver(Fill&& fill);
 
     static void net_connection_status_changed_callback(SteamNetConnectionStatusChangedCallback_t* p_info)
     {
@@ -55,6 +215,16 @@ private:
     }
 };
 
+template <typename T>
+GameClient::EventAwaiter GameClient::request(const T& msg, int k_n_flag, NetEventKind reply)
+{
+    EventAwaiter awaiter(*this, reply);
+    awaiter.m_request.resize(encoded_message_size<T>());
+    encode_message(msg, awaiter.m_request.data(), awaiter.m_request.size());
+    awaiter.m_request_flag = k_n_flag;
+    return awaiter;
+}
+
 void fatal_error(const char* fmt, ...);
 void debug_output(ESteamNetworkingSocketsDebugOutputType eType, const char* pszMsg);
 void printt(const char* fmt, ...);
@@ -0,0 +1,781 @@
+#include "game_room.h"
+#include "message_batch.h"
+#include "net_schema.h"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <iostream>
+
+void printt(const char* fmt, ...);
+
+namespace {
+
+struct RateLimit {
+    float per_second;
+    float burst;
+    bool  coalesce; // state: past the limit it's still applied, nothing is relayed per record
+};
+
+// Indexed by GameRoom::RateClass. Generous for a real client at a high frame
+// rate; a flood of droppable records costs the room a bucket check per
+// record and no sends, and past the limit on any other the client is cut off.
+constexpr RateLimit RATE_LIMITS[] = {
+    { 60.0f, 30.0f, true },  // Position, sent every frame while moving
+    { 30.0f, 15.0f, false }, // Direction, relayed to everyone
+    { 5.0f, 10.0f, false },  // Chat, broadcast
+    { 15.0f, 10.0f, false }, // Bullet, one per click
+    { 1.0f, 4.0f, false },   // MsgPlayerJoined / MsgPlayerLeft
+};
+
+}
+
+ServerStats& ServerStats::operator+=(const ServerStats& other)
+{
+    messages_received += other.messages_received;
+    records_received += other.records_received;
+    bytes_received += other.bytes_received;
+    messages_sent += other.messages_sent;
+    bytes_sent += other.bytes_sent;
+    updates_sent += other.updates_sent;
+    updates_expired += other.updates_expired;
+    load_mode_changes += other.load_mode_changes;
+    degraded_ticks += other.degraded_ticks;
+    cosmetic_dropped += other.cosmetic_dropped;
+    chat_coalesced += other.chat_coalesced;
+    congested_ticks += other.congested_ticks;
+    unreliable_suppressed += other.unreliable_suppressed;
+    rate_limited += other.rate_limited;
+    rate_coalesced += other.rate_coalesced;
+    positions_suppressed += other.positions_suppressed;
+    return *this;
+}
+
+GameRoom::GameRoom(uint32_t id, ISteamNetworkingSockets* sockets, NetRecorder* recorder, uint32_t client_bytes_per_second,
+    double tick_budget_ms)
+    : m_id(id)
+    , m_sockets(sockets)
+    , m_recorder(recorder)
+    , m_client_bytes_per_second(client_bytes_per_second)
+    , m_governor(tick_budget_ms)
+{
+}
+
+void GameRoom::post_join(HSteamNetConnection conn, std::string_view nick)
+{
+    post({ InboundKind::Join, conn, std::string(nick) });
+}
+
+void GameRoom::post_leave(HSteamNetConnection conn, std::string_view reason)
+{
+    post({ InboundKind::Leave, conn, std::string(reason) });
+}
+
+void GameRoom::post_message(HSteamNetConnection conn, const void* data, uint32 size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    post({ InboundKind::Message, conn, {}, std::vector<uint8_t>(bytes, bytes + size) });
+}
+
+void GameRoom::post(Inbound inbound)
+{
+    std::lock_guard<std::mutex> lock(m_inbound_mutex);
+    m_inbound.push_back(std::move(inbound));
+}
+
+void GameRoom::apply_inbound()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_inbound_mutex);
+        std::swap(m_inbound, m_processing);
+    }
+
+    for (const Inbound& inbound : m_processing) {
+        switch (inbound.kind) {
+        case InboundKind::Join:
+            join(inbound.conn, inbound.text);
+            break;
+        case InboundKind::Leave:
+            leave(inbound.conn, inbound.text);
+            break;
+        case InboundKind::Message:
+            handle_message(inbound.conn, inbound.data);
+            break;
+        }
+    }
+    m_processing.clear();
+}
+
+void GameRoom::update(float dt)
+{
+    auto start = std::chrono::steady_clock::now();
+    m_time += dt;
+
+    apply_inbound();
+    flush_chat();
+    expire_reservations(dt);
+    ++m_tick;
+    publish();
+
+    double   tick_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LoadMode before  = m_governor.mode();
+    if (m_governor.observe(tick_ms, m_missed_ticks.exchange(0))) {
+        ++m_stats.load_mode_changes;
+        printt("Room %u load %.2f: %s -> %s\n", m_id, m_governor.load(),
+            load_mode_name(before), load_mode_name(m_governor.mode()));
+    }
+    if (m_governor.mode() != LoadMode::Normal) {
+        ++m_stats.degraded_ticks;
+    }
+}
+
+ServerStats GameRoom::stats() const
+{
+    ServerStats total = m_stats;
+    total += m_send_stats;
+    return total;
+}
+
+void GameRoom::publish()
+{
+    std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+
+    // send() took the previous snapshot, and with it every spawn in it.
+    if (m_published < 0) {
+        m_spawns.erase(m_spawns.begin(), m_spawns.begin() + m_spawns_published);
+    }
+
+    Snapshot& snapshot = m_snapshots[m_reading == 0 ? 1 : 0];
+    snapshot.tick      = m_tick;
+    snapshot.mode      = m_governor.mode();
+    snapshot.players.clear();
+    for (const auto& [conn, client] : m_map_clients) {
+        snapshot.players.push_back({ conn, client.id, client.pos });
+    }
+    snapshot.spawns.assign(m_spawns.begin(), m_spawns.end());
+    m_spawns_published = m_spawns.size();
+    m_published        = static_cast<int>(&snapshot - m_snapshots);
+
+    m_congested.clear();
+    m_congested.insert(m_congested_published.begin(), m_congested_published.end());
+}
+
+void GameRoom::send(float tick_dt)
+{
+    const Snapshot* snapshot;
+    {
+        std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+        if (m_published < 0)
+            return;
+        m_reading   = m_published;
+        m_published = -1;
+        snapshot    = &m_snapshots[m_reading];
+    }
+
+    // Snapshots replaced before we got to them were never sent; to the
+    // load governor that is the same as a tick that ran late.
+    uint64_t ticks = snapshot->tick - m_last_sent_tick;
+    if (m_last_sent_tick != 0 && ticks > 1) {
+        m_missed_ticks += static_cast<uint32_t>(ticks - 1);
+    }
+    m_last_sent_tick = snapshot->tick;
+
+    queue_snapshot(*snapshot);
+    send_updates(*snapshot, tick_dt * ticks);
+
+    std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+    m_reading = -1;
+    m_congested_published.swap(m_send_congested);
+}
+
+// Turns a snapshot into pending updates: positions of players who moved
+// since the last snapshot we queued, and every new bullet.
+void GameRoom::queue_snapshot(const Snapshot& snapshot)
+{
+    for (const Snapshot::Player& player : snapshot.players) {
+        m_outbound[player.conn].seen = snapshot.tick;
+    }
+    std::erase_if(m_outbound, [&](const auto& entry) { return entry.second.seen != snapshot.tick; });
+
+    for (const Snapshot::Player& player : snapshot.players) {
+        if (player.id == 0)
+            continue;
+
+        // Small moves wait until they add up to the epsilon, or until the
+        // player stops, so everyone sees exactly where they came to rest.
+        // That last update goes out unreliably, so it is repeated for
+        // REST_RESENDS snapshots while they stay put; one lost datagram
+        // would otherwise leave them frozen short of it.
+        auto        it_sent = m_sent_index.find(player.id);
+        SentPlayer* sent    = it_sent != m_sent_index.end() ? &m_sent_players[it_sent->second] : nullptr;
+        if (sent) {
+            bool  moving = sent->last.x != player.pos.x || sent->last.y != player.pos.y;
+            float drift  = std::hypot(player.pos.x - sent->pos.x, player.pos.y - sent->pos.y);
+            sent->last   = player.pos;
+            sent->seen   = snapshot.tick;
+            if (drift == 0.0f) {
+                if (moving || sent->rest_resends == 0)
+                    continue;
+                --sent->rest_resends;
+            } else if (moving && drift < m_position_epsilon) {
+                ++m_send_stats.positions_suppressed;
+                continue;
+            } else {
+                *sent = { player.id, player.pos, player.pos, snapshot.tick, REST_RESENDS };
+            }
+        } else {
+            m_sent_index[player.id] = m_sent_players.size();
+            m_sent_players.push_back({ player.id, player.pos, player.pos, snapshot.tick, REST_RESENDS });
+        }
+
+        uint8_t buffer[encoded_message_size<MsgPlayerPositionChanged>()];
+        size_t  size = encode_message(MsgPlayerPositionChanged { player.id, player.pos }, buffer, sizeof(buffer));
+        for (auto& [conn, outbound] : m_outbound) {
+            if (conn != player.conn)
+                outbound.queue.push(player.id, UpdateClass::Player, player.pos, buffer, size);
+        }
+    }
+
+    // Players who left the game, or the room, take their pending updates
+    // with them. Only the players of the last snapshot are walked, however
+    // many ids the room has handed out.
+    for (size_t i = 0; i < m_sent_players.size();) {
+        SentPlayer& sent = m_sent_players[i];
+        if (sent.seen == snapshot.tick) {
+            ++i;
+            continue;
+        }
+
+        for (auto& [conn, outbound] : m_outbound) {
+            outbound.queue.erase(sent.id);
+        }
+        m_sent_index.erase(sent.id);
+        if (i + 1 != m_sent_players.size()) {
+            sent                  = m_sent_players.back();
+            m_sent_index[sent.id] = i;
+        }
+        m_sent_players.pop_back();
+    }
+
+    for (const Snapshot::Spawn& spawn : snapshot.spawns) {
+        uint8_t buffer[encoded_message_size<MsgSpawnBullet>()];
+        size_t  size = encode_message(spawn.msg, buffer, sizeof(buffer));
+        for (auto& [conn, outbound] : m_outbound) {
+            if (conn != spawn.from)
+                outbound.queue.push(spawn.key, UpdateClass::Bullet, spawn.msg.pos, buffer, size);
+        }
+    }
+}
+
+void GameRoom::flush_chat()
+{
+    if (m_chat_backlog.empty())
+        return;
+
+    std::string text;
+    for (const auto& [conn, client] : m_map_clients) {
+        text.clear();
+        for (const ChatLine& line : m_chat_backlog) {
+            if (line.from == conn)
+                continue;
+            if (!text.empty())
+                text += '\n';
+            text += line.text;
+        }
+        if (!text.empty()) {
+            send_message_to_client(conn, text.substr(0, UINT16_MAX));
+        }
+    }
+    m_chat_backlog.clear();
+}
+
+void GameRoom::expire_reservations(float dt)
+{
+    for (auto it = m_reserved.begin(); it != m_reserved.end();) {
+        it->second.age += dt;
+        if (it->second.age > RESERVATION_SECONDS) {
+            it = m_reserved.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+RoomCheckpoint GameRoom::checkpoint()
+{
+    // Joins and leaves the last tick didn't get to would be lost or saved
+    // stale otherwise.
+    apply_inbound();
+
+    RoomCheckpoint checkpoint;
+    checkpoint.id              = m_id;
+    checkpoint.next_player_id  = m_next_player_id;
+    checkpoint.next_bullet_key = m_next_bullet_key;
+
+    for (const auto& [conn, client] : m_map_clients) {
+        if (client.id != 0)
+            checkpoint.players.push_back({ client, m_tokens[conn] });
+    }
+    // Unclaimed ones too, so back-to-back restarts don't lose them.
+    for (const auto& [id, reservation] : m_reserved) {
+        checkpoint.players.push_back({ reservation.client, reservation.token });
+    }
+    return checkpoint;
+}
+
+void GameRoom::restore(const RoomCheckpoint& checkpoint)
+{
+    m_next_player_id  = std::max(m_next_player_id, checkpoint.next_player_id);
+    m_next_bullet_key = checkpoint.next_bullet_key;
+    for (const CheckpointPlayer& player : checkpoint.players) {
+        m_reserved[player.client.id] = { player.client, player.token };
+    }
+}
+
+void GameRoom::join(HSteamNetConnection conn, const std::string& nick)
+{
+    // Names and positions come with MsgInitialState once the player joins
+    // the game; the greeting only says how many.
+    send_message_to_client(conn, std::format("Thou hast entered room {}. {} companions greet you.",
+                                     m_id, m_map_clients.size()));
+
+    if (shedding(LoadMode::DropCosmetic)) {
+        ++m_stats.cosmetic_dropped;
+    } else {
+        send_message_to_all_clients(
+            std::format("Hark! A stranger hath joined: '{}'", nick), conn);
+    }
+
+    Client& client = m_map_clients[conn];
+    size_t  n      = std::min(nick.size(), sizeof(client.nick) - 1);
+    memcpy(client.nick, nick.data(), n);
+    client.nick[n] = '\0';
+
+    RateLimits& limits = m_rate_limits[conn];
+    for (size_t i = 0; i < limits.size(); ++i) {
+        limits[i] = TokenBucket(RATE_LIMITS[i].per_second, RATE_LIMITS[i].burst, m_time);
+    }
+
+    m_client_count = m_map_clients.size();
+}
+
+void GameRoom::leave(HSteamNetConnection conn, const std::string& reason)
+{
+    auto it_client = m_map_clients.find(conn);
+    if (it_client == m_map_clients.end())
+        return;
+
+    // Still in the game, so the others have an entity for it to remove.
+    uint32_t id = it_client->second.id;
+    m_map_clients.erase(it_client);
+    if (id != 0) {
+        send_data_to_all_clients(MsgPlayerLeft { id }, conn, k_nSteamNetworkingSend_Reliable);
+    }
+
+    m_roster.remove(conn);
+    m_rate_limits.erase(conn);
+    m_flooding.erase(conn);
+    m_tokens.erase(conn);
+    m_client_count = m_map_clients.size();
+
+    if (reason.empty())
+        return;
+    if (shedding(LoadMode::DropCosmetic)) {
+        ++m_stats.cosmetic_dropped;
+    } else {
+        send_message_to_all_clients(reason);
+    }
+}
+
+void GameRoom::handle_message(HSteamNetConnection conn, const std::vector<uint8_t>& data)
+{
+    MsgHeader header;
+    if (!decode_header(data.data(), data.size(), header))
+        return; // the server checked the size before posting
+
+    const uint8_t* payload = data.data() + MSG_HEADER_SIZE;
+
+    if (header.type != MsgType::Batch) {
+        handle_record(conn, header, payload);
+        return;
+    }
+
+    bool ok = for_each_batch_record(payload, header.size, [&](const MsgHeader& record, const uint8_t* record_payload) {
+        handle_record(conn, record, record_payload);
+        return true;
+    });
+    if (!ok) {
+        // The server drops senders of these before posting.
+        printt("Room %u received malformed batch from %u\n", m_id, conn);
+    }
+}
+
+void GameRoom::handle_record(HSteamNetConnection conn, const MsgHeader& header, const uint8_t* payload)
+{
+    ++m_stats.records_received;
+
+    auto it_client = m_map_clients.find(conn);
+    if (it_client == m_map_clients.end() || !admit(conn, header.type))
+        return;
+
+    switch (header.type) {
+    case MsgType::Direction: {
+        Direction dir;
+        if (!decode_payload(payload, header.size, dir)) {
+            printt("Server received Invalid dir packet size\n");
+            break;
+        }
+
+        // Nothing reads relayed directions yet, so they're first to go.
+        if (shedding(LoadMode::DropCosmetic)) {
+            ++m_stats.cosmetic_dropped;
+            break;
+        }
+        send_data_to_all_clients(dir, it_client->first);
+        printt("Direction x=%f y=%f\n", dir.x, dir.y);
+    } break;
+
+    case MsgType::ChatMessage: {
+        std::string text((char*)payload, header.size);
+        std::string outgoing_msg = std::format("{}: {}",
+            it_client->second.nick, text);
+        if (shedding(LoadMode::CoalesceChat)) {
+            m_chat_backlog.push_back({ it_client->first, std::move(outgoing_msg) });
+            ++m_stats.chat_coalesced;
+            break;
+        }
+        send_message_to_all_clients(outgoing_msg, it_client->first);
+        std::cout << "user_msg: " << outgoing_msg << "\n"; // DEBUG_PRINT
+
+    } break;
+
+    case MsgType::Position: {
+        Position pos;
+        if (!decode_payload(payload, header.size, pos)) {
+            printt("Server received Invalid dir packet size\n");
+            break;
+        }
+        // send() picks the change up from the next snapshot.
+        it_client->second.pos = pos;
+        m_roster.set_position(it_client->first, pos);
+        // printt("Position x=%f y=%f\n", pos.x, pos.y);
+
+    } break;
+
+    case MsgType::MsgPlayerJoined: {
+        MsgPlayerJoined joined_msg;
+        if (!decode_payload(payload, header.size, joined_msg)) {
+            printt("Server received Invalid dir packet size\n");
+            break;
+        }
+
+        // Everyone already in the room, in one message.
+        send_to_connection(it_client->first, m_roster.message(), static_cast<uint32>(m_roster.message_size()),
+            k_nSteamNetworkingSend_Reliable);
+
+        // A client back from a server restart keeps its old id, so the
+        // others' tables and its own PlayerId stay valid, if it still has
+        // the token that came with the id; everyone else gets a fresh one.
+        // The client's own position wins, it kept simulating.
+        auto it_reserved = joined_msg.id != 0 ? m_reserved.find(joined_msg.id) : m_reserved.end();
+        if (it_reserved != m_reserved.end() && joined_msg.token != 0 && joined_msg.token == it_reserved->second.token) {
+            m_reserved.erase(it_reserved);
+        } else {
+            joined_msg.id = next_player_id();
+            do {
+                joined_msg.token = m_token_rng();
+            } while (joined_msg.token == 0);
+        }
+        m_tokens[it_client->first] = joined_msg.token;
+
+        it_client->second.id  = joined_msg.id;
+        it_client->second.pos = joined_msg.position;
+        if (!m_roster.add(it_client->first, it_client->second)) {
+            printt("Room %u roster is full, '%d' joins unlisted\n", m_id, joined_msg.id);
+        }
+
+        MsgPlayerIdAssign assigned_id { joined_msg.id, joined_msg.token };
+        send_data(it_client->first, assigned_id, k_nSteamNetworkingSend_Reliable);
+
+        joined_msg.token = 0; // only its owner gets to see it
+
+        send_data_to_all_clients(joined_msg, it_client->first,
+            k_nSteamNetworkingSend_Reliable);
+        printt("Player '%d' joined x=%f y=%f\n",
+            joined_msg.id, joined_msg.position.x, joined_msg.position.y);
+    } break;
+
+    case MsgType::MsgPlayerLeft: {
+        MsgPlayerLeft left_msg;
+        if (!decode_payload(payload, header.size, left_msg)) {
+            printt("Server received Invalid dir packet size\n");
+            break;
+        }
+
+        // Out of the game but still connected; its id leaves the snapshot.
+        m_roster.remove(it_client->first);
+        it_client->second.id = 0;
+        send_data_to_all_clients(left_msg, it_client->first,
+            k_nSteamNetworkingSend_Reliable);
+        printt("Player '%d' left.\n", left_msg.id);
+    } break;
+
+    case MsgType::MsgPlayerPositionChanged: {
+        MsgPlayerPositionChanged position_changed_msg;
+        if (!decode_payload(payload, header.size, position_changed_msg)) {
+            printt("Client received Invalid MsgPlayerPositionChanged packet size\n");
+            break;
+        }
+
+        printt("Player '%d' position changed x: '%f' y: '%f'.\n",
+            position_changed_msg.id, position_changed_msg.position.x, position_changed_msg.position.y);
+    } break;
+
+    case MsgType::MsgSpawnBullet: {
+        MsgSpawnBullet spawn_bullet_msg;
+        if (!decode_payload(payload, header.size, spawn_bullet_msg)) {
+            printt("Client received Invalid MsgSpawnBullet packet size\n");
+            break;
+        }
+
+        // Bullets are keyed above every player id, one key per spawn.
+        uint64_t key = (uint64_t { 1 } << 32) | m_next_bullet_key++;
+        m_spawns.push_back({ key, it_client->first, spawn_bullet_msg });
+
+        // printt("Player '%d' position changed x: '%f' y: '%f'.\n",
+        //     spawn_bullet_msg.id, spawn_bullet_msg.position.x, spawn_bullet_msg.position.y);
+    } break;
+
+    default:
+        printt("Server received Unknown message type\n");
+    }
+}
+
+// Ids count up, so a late update for a player who left can't land on a
+// newcomer. Only once they reach the clients' EntityTable limit are ids
+// freed by leaves handed out again, lowest first.
+uint32_t GameRoom::next_player_id()
+{
+    constexpr uint32_t LAST_ID = EntityTable<Client>::MAX_ID - 1;
+    if (m_next_player_id <= LAST_ID)
+        return m_next_player_id++;
+
+    std::unordered_set<uint32_t> taken;
+    for (const auto& [conn, client] : m_map_clients) {
+        taken.insert(client.id);
+    }
+    for (const auto& [id, reservation] : m_reserved) {
+        taken.insert(id);
+    }
+    for (uint32_t id = 1; id <= LAST_ID; ++id) {
+        if (!taken.contains(id))
+            return id;
+    }
+    return 0; // a room can't hold a million players; the roster fills first
+}
+
+// Checks a record against its connection's bucket for the type. False if
+// it should be dropped; everything past the limit is counted. Past it on a
+// record that isn't droppable, the connection is handed to the server to
+// disconnect and nothing more from it is applied.
+bool GameRoom::admit(HSteamNetConnection conn, MsgType type)
+{
+    if (!m_rate_limited)
+        return true;
+    if (m_flooding.contains(conn))
+        return false;
+
+    RateClass cls;
+    switch (type) {
+    case MsgType::Position:
+        cls = RateClass::Position;
+        break;
+    case MsgType::Direction:
+        cls = RateClass::Direction;
+        break;
+    case MsgType::ChatMessage:
+        cls = RateClass::Chat;
+        break;
+    case MsgType::MsgSpawnBullet:
+        cls = RateClass::Bullet;
+        break;
+    case MsgType::MsgPlayerJoined:
+    case MsgType::MsgPlayerLeft:
+        cls = RateClass::JoinLeave;
+        break;
+    default:
+        return true;
+    }
+
+    auto it = m_rate_limits.find(conn);
+    if (it == m_rate_limits.end() || it->second[static_cast<size_t>(cls)].take(m_time))
+        return true;
+
+    if (RATE_LIMITS[static_cast<size_t>(cls)].coalesce) {
+        ++m_stats.rate_coalesced;
+        return true;
+    }
+    ++m_stats.rate_limited;
+    if (!is_droppable(type) && m_flooding.insert(conn).second) {
+        std::lock_guard<std::mutex> lock(m_flooders_mutex);
+        m_flooders.push_back(conn);
+    }
+    return false;
+}
+
+std::vector<HSteamNetConnection> GameRoom::take_flooders()
+{
+    std::vector<HSteamNetConnection> flooders;
+    std::lock_guard<std::mutex>      lock(m_flooders_mutex);
+    flooders.swap(m_flooders);
+    return flooders;
+}
+
+void GameRoom::send_updates(const Snapshot& snapshot, float dt)
+{
+    bool  thin        = snapshot.mode >= LoadMode::ThinFar && snapshot.tick % FAR_UPDATE_INTERVAL != 0;
+    float hold_beyond = thin ? FAR_DISTANCE : INFINITY;
+
+    m_send_congested.clear();
+    for (const Snapshot::Player& player : snapshot.players) {
+        HSteamNetConnection  conn     = player.conn;
+        size_t               budget   = send_budget(conn, dt);
+        PriorityAccumulator& outbound = m_outbound[conn].queue;
+
+        uint64_t expired = outbound.expired();
+        outbound.accumulate(player.pos, dt, hold_beyond);
+        m_send_stats.updates_expired += outbound.expired() - expired;
+
+        // Leaving updates in the accumulator is latest-wins: a newer state
+        // for the same entity replaces the held one instead of queueing
+        // behind it in the socket.
+        if (budget == 0) {
+            if (outbound.pending() > 0) {
+                ++m_send_stats.congested_ticks;
+            }
+            continue;
+        }
+
+        MessageBatch batch;
+        while (outbound.pending() > 0) {
+            size_t used = outbound.fill(batch, budget);
+            if (batch.empty())
+                break;
+
+            m_send_stats.updates_sent += batch.records();
+            size_t         size;
+            const uint8_t* data = batch.finish(size);
+            transmit(m_send_stats, conn, data, static_cast<uint32>(size), k_nSteamNetworkingSend_Unreliable);
+            batch.clear();
+            budget -= used;
+        }
+    }
+}
+
+// Bytes of updates `conn` may take this tick: our per-client budget, capped
+// by what the library's congestion control is willing to send. Zero, and
+// the connection is marked congested, while its send queue is backed up.
+size_t GameRoom::send_budget(HSteamNetConnection conn, float dt)
+{
+    size_t budget = static_cast<size_t>(m_client_bytes_per_second * dt);
+    if (!m_sockets)
+        return budget;
+
+    SteamNetConnectionRealTimeStatus_t status;
+    if (m_sockets->GetConnectionRealTimeStatus(conn, &status, 0, nullptr) != k_EResultOK)
+        return budget;
+
+    if (status.m_cbPendingUnreliable > CONGESTED_PENDING_BYTES || status.m_usecQueueTime > CONGESTED_QUEUE_USEC) {
+        m_send_congested.push_back(conn);
+        return 0;
+    }
+
+    int64_t room = static_cast<int64_t>(status.m_nSendRateBytesPerSecond * dt)
+        - status.m_cbPendingUnreliable - status.m_cbPendingReliable;
+    return std::min(budget, static_cast<size_t>(std::max<int64_t>(room, 0)));
+}
+
+void GameRoom::send_message_to_all_clients(std::string_view msg, HSteamNetConnection except)
+{
+    std::vector<uint8_t> buffer;
+    encode_chat_message(msg, buffer);
+
+    for (const auto& [conn, client] : m_map_clients) {
+        if (conn != except) {
+            send_to_connection(conn, buffer.data(), static_cast<uint32>(buffer.size()), k_nSteamNetworkingSend_Reliable);
+        }
+    }
+}
+
+void GameRoom::send_message_to_client(HSteamNetConnection conn, std::string_view msg)
+{
+    std::vector<uint8_t> buffer;
+    encode_chat_message(msg, buffer);
+
+    send_to_connection(conn, buffer.data(), static_cast<uint32>(buffer.size()), k_nSteamNetworkingSend_Reliable);
+}
+
+void GameRoom::encode_chat_message(std::string_view msg, std::vector<uint8_t>& buffer)
+{
+    MsgHeader header;
+    header.type = MsgType::ChatMessage;
+    header.size = static_cast<uint16_t>(msg.size());
+
+    buffer.resize(MSG_HEADER_SIZE + msg.size());
+
+    NetWriter writer(buffer.data(), buffer.size());
+    net_schema::write(writer, header);
+    writer.raw(msg.data(), msg.size());
+}
+
+template <typename T>
+void GameRoom::send_data_to_all_clients(const T data, HSteamNetConnection except, const int k_n_flag)
+{
+    uint8_t buffer[encoded_message_size<T>()];
+    size_t  size = encode_message(data, buffer, sizeof(buffer));
+
+    bool unreliable = (k_n_flag & k_nSteamNetworkingSend_Reliable) == 0;
+    for (const auto& [conn, client] : m_map_clients) {
+        if (conn == except)
+            continue;
+        // Unreliable data is superseded by the next tick anyway; don't add
+        // to a queue that is already late.
+        if (unreliable && m_congested.contains(conn)) {
+            ++m_stats.unreliable_suppressed;
+            continue;
+        }
+        send_to_connection(conn, buffer, size, k_n_flag);
+    }
+}
+
+template <typename T>
+void GameRoom::send_data(HSteamNetConnection conn, const T data, int k_n_flag)
+{
+    uint8_t buffer[encoded_message_size<T>()];
+    size_t  size = encode_message(data, buffer, sizeof(buffer));
+
+    send_to_connection(conn, buffer, size, k_n_flag);
+}
+
+void GameRoom::send_to_connection(HSteamNetConnection conn, const void* data, uint32 data_size, int k_n_flag)
+{
+    transmit(m_stats, conn, data, data_size, k_n_flag);
+}
+
+// Sockets are thread safe; the recorder takes its own lock. Counted in the
+// caller's side of the stats.
+void GameRoom::transmit(ServerStats& stats, HSteamNetConnection conn, const void* data, uint32 data_size, int k_n_flag)
+{
+    ++stats.messages_sent;
+    stats.bytes_sent += data_size;
+
+    if (m_recorder) {
+        m_recorder->record(RecordKind::Sent, conn, data, data_size);
+    }
+
+    if (m_sockets) {
+        m_sockets->SendMessageToConnection(conn, data, data_size, k_n_flag, nullptr);
+    }
+}
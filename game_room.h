@@ -0,0 +1,264 @@
+#pragma once
+
+#include "checkpoint.h"
+#include "entity_table.h"
+#include "load_governor.h"
+#include "net_messages.h"
+#include "net_recorder.h"
+#include "priority_accumulator.h"
+#include "roster.h"
+#include "token_bucket.h"
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <steam/isteamnetworkingsockets.h>
+#include <steam/steamnetworkingtypes.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Players who moved less than this many pixels since their last update
+// sent aren't sent again until they move further or come to rest.
+constexpr float DEFAULT_POSITION_EPSILON = 1.0f;
+
+struct ServerStats {
+    uint64_t messages_received {};
+    uint64_t records_received {}; // messages after unpacking batches
+    uint64_t bytes_received {};
+    uint64_t messages_sent {};
+    uint64_t bytes_sent {};
+    uint64_t updates_sent {};
+    uint64_t updates_expired {};      // dropped from a priority queue before their turn
+    uint64_t positions_suppressed {}; // moved less than the position epsilon since last sent
+    uint64_t load_mode_changes {};
+    uint64_t degraded_ticks {};   // ticks spent in any mode but Normal
+    uint64_t cosmetic_dropped {}; // shed by LoadMode::DropCosmetic
+    uint64_t chat_coalesced {};   // lines held for LoadMode::CoalesceChat
+    uint64_t congested_ticks {};  // client ticks whose updates were held for a backed-up connection
+    uint64_t unreliable_suppressed {};
+    uint64_t rate_limited {};   // inbound messages or records dropped by a token bucket
+    uint64_t rate_coalesced {}; // over the limit, but state where only the latest counts
+
+    ServerStats& operator+=(const ServerStats& other);
+};
+
+// One independent match: its own players, ids, bullets and outbound
+// priorities. The server's network thread only posts joins, leaves and
+// messages into the room; update() applies them and runs the tick on
+// whichever pool thread picked the room up, never two at once.
+//
+// Entity updates are encoded and sent by send(), which may run on another
+// thread at the same time as update(). Each update() publishes what send()
+// needs into one of two snapshot buffers; send() reads the latest while
+// the next tick fills the other, so slow sends never hold up a tick.
+class GameRoom {
+public:
+    GameRoom(uint32_t id, ISteamNetworkingSockets* sockets, NetRecorder* recorder, uint32_t client_bytes_per_second,
+        double tick_budget_ms);
+
+    uint32_t id() const { return m_id; }
+    size_t   client_count() const { return m_client_count; }
+
+    // Thread safe, applied by the next update().
+    void post_join(HSteamNetConnection conn, std::string_view nick);
+    void post_leave(HSteamNetConnection conn, std::string_view reason);
+    void post_message(HSteamNetConnection conn, const void* data, uint32 size);
+
+    void update(float dt);
+    // Sends the latest snapshot's entity updates, if update() published one
+    // since the last call. Never two at once; `tick_dt` is update()'s dt.
+    void send(float tick_dt);
+
+    // Only while no update() is running; applies whatever is still posted
+    // first. Restored players wait as reservations until their client
+    // rejoins with its token or RESERVATION_SECONDS pass.
+    RoomCheckpoint checkpoint();
+    void           restore(const RoomCheckpoint& checkpoint);
+
+    // Thread safe. Connections that went past a rate limit on records that
+    // aren't droppable since the last call, for the server to disconnect.
+    std::vector<HSteamNetConnection> take_flooders();
+
+    // Only while no update() or send() is running.
+    ServerStats stats() const;
+    void        set_position_epsilon(float epsilon) { m_position_epsilon = epsilon; }
+    void        set_rate_limited(bool limited) { m_rate_limited = limited; } // off for benchmarks
+
+    // Set by the scheduler while the room is queued or updating, and while
+    // it is queued or sending.
+    std::atomic<bool> m_scheduled { false };
+    std::atomic<bool> m_sending { false };
+    // Ticks the scheduler skipped because the room was still busy.
+    std::atomic<uint32_t> m_missed_ticks { 0 };
+
+    LoadMode load_mode() const { return m_governor.mode(); }
+
+private:
+    enum class InboundKind : uint8_t {
+        Join,
+        Leave,
+        Message,
+    };
+
+    static constexpr float RESERVATION_SECONDS = 120.0f;
+
+    // Snapshots after the last queued position that repeat it while the
+    // player stands still. Nothing else follows the update a player came to
+    // rest with, and it goes out unreliably.
+    static constexpr uint8_t REST_RESENDS = 3;
+
+    // LoadMode::ThinFar: updates beyond FAR_DISTANCE from a client's player
+    // only go out every FAR_UPDATE_INTERVAL ticks.
+    static constexpr float    FAR_DISTANCE        = 1200.0f;
+    static constexpr uint32_t FAR_UPDATE_INTERVAL = 3;
+
+    // A connection counts as congested while more unreliable bytes than
+    // this are still queued, or anything has waited longer than
+    // CONGESTED_QUEUE_USEC to go out.
+    static constexpr int                         CONGESTED_PENDING_BYTES = 2 * BATCH_MAX_BYTES;
+    static constexpr SteamNetworkingMicroseconds CONGESTED_QUEUE_USEC    = 50'000;
+
+    // Inbound records per connection and type, see RATE_LIMITS.
+    enum class RateClass : uint8_t {
+        Position,
+        Direction,
+        Chat,
+        Bullet,
+        JoinLeave,
+        Count,
+    };
+    using RateLimits = std::array<TokenBucket, static_cast<size_t>(RateClass::Count)>;
+
+    struct ChatLine {
+        HSteamNetConnection from;
+        std::string         text;
+    };
+
+    // Everything send() reads, copied out of the room at the end of a tick.
+    struct Snapshot {
+        struct Player {
+            HSteamNetConnection conn;
+            uint32_t            id; // 0 until MsgPlayerJoined, and after MsgPlayerLeft
+            Position            pos;
+        };
+        struct Spawn {
+            uint64_t            key;
+            HSteamNetConnection from;
+            MsgSpawnBullet      msg;
+        };
+
+        uint64_t            tick {};
+        LoadMode            mode {};
+        std::vector<Player> players;
+        std::vector<Spawn>  spawns; // all that send() hasn't taken yet
+    };
+
+    // send() side, per connection.
+    struct Outbound {
+        PriorityAccumulator queue;
+        uint64_t            seen {}; // snapshot tick the connection was last in
+    };
+    struct SentPlayer {
+        uint32_t id;
+        Position pos;  // as last queued
+        Position last; // as of the last snapshot, queued or not
+        uint64_t seen {};
+        uint8_t  rest_resends {}; // left of REST_RESENDS while pos stays put
+    };
+
+    struct Reservation {
+        Client   client;
+        uint64_t token {};
+        float    age {};
+    };
+
+    struct Inbound {
+        InboundKind          kind;
+        HSteamNetConnection  conn;
+        std::string          text; // nick or leave reason
+        std::vector<uint8_t> data;
+    };
+
+    const uint32_t           m_id;
+    ISteamNetworkingSockets* m_sockets;
+    NetRecorder*             m_recorder;
+    const uint32_t           m_client_bytes_per_second;
+
+    // Only the server's main thread posts, so this could be an SpscRing,
+    // but a ring is bounded: a room that falls behind would have to stall
+    // the main thread or drop joins and leaves. The lock is taken once per
+    // post and once per tick to swap, so it is rarely contended.
+    std::mutex           m_inbound_mutex;
+    std::vector<Inbound> m_inbound;
+    std::vector<Inbound> m_processing; // swapped with m_inbound each update
+
+    // update() thread only
+    std::unordered_map<HSteamNetConnection, Client>     m_map_clients;
+    Roster                                              m_roster; // players who sent MsgPlayerJoined
+    std::unordered_map<uint32_t, Reservation>           m_reserved; // by player id, from a checkpoint
+    std::unordered_map<HSteamNetConnection, uint64_t>   m_tokens;   // reconnect tokens, once joined
+    std::mt19937_64                                     m_token_rng { std::random_device {}() };
+    uint32_t                                            m_next_player_id { 1 };
+    uint64_t                                            m_next_bullet_key {};
+    ServerStats                                         m_stats;
+    std::atomic<size_t>                                 m_client_count {};
+    LoadGovernor                                        m_governor;
+    uint64_t                                            m_tick {};
+    double                                              m_time {}; // sum of update() dts, for the rate limits
+    std::vector<ChatLine>                               m_chat_backlog; // LoadMode::CoalesceChat
+    std::unordered_set<HSteamNetConnection>             m_congested;    // as of send()'s last pass
+    std::vector<Snapshot::Spawn>                        m_spawns;       // not yet taken by send()
+    size_t                                              m_spawns_published {};
+    std::unordered_map<HSteamNetConnection, RateLimits> m_rate_limits;
+    std::unordered_set<HSteamNetConnection>             m_flooding; // waiting for the server to drop them
+    bool                                                m_rate_limited { true };
+
+    std::mutex                       m_flooders_mutex;
+    std::vector<HSteamNetConnection> m_flooders;
+
+    // Shared. The lock covers picking, publishing and taking buffers, not
+    // reading them: send() owns m_snapshots[m_reading] until it is done.
+    std::mutex                       m_snapshot_mutex;
+    Snapshot                         m_snapshots[2];
+    int                              m_published { -1 }; // waiting for send(), -1 once taken
+    int                              m_reading { -1 };   // being read by send()
+    std::vector<HSteamNetConnection> m_congested_published;
+
+    // send() thread only
+    std::unordered_map<HSteamNetConnection, Outbound> m_outbound;
+    std::vector<SentPlayer>                           m_sent_players; // players in the last snapshot
+    std::unordered_map<uint32_t, size_t>              m_sent_index;   // player id -> m_sent_players slot
+    std::vector<HSteamNetConnection>                  m_send_congested;
+    uint64_t                                          m_last_sent_tick {};
+    ServerStats                                       m_send_stats;
+    float                                             m_position_epsilon { DEFAULT_POSITION_EPSILON };
+
+    void post(Inbound inbound);
+    void apply_inbound();
+    void join(HSteamNetConnection conn, const std::string& nick);
+    void leave(HSteamNetConnection conn, const std::string& reason);
+    void handle_message(HSteamNetConnection conn, const std::vector<uint8_t>& data);
+    void handle_record(HSteamNetConnection conn, const MsgHeader& header, const uint8_t* payload);
+    bool admit(HSteamNetConnection conn, MsgType type);
+    uint32_t next_player_id();
+    void publish();
+    void queue_snapshot(const Snapshot& snapshot);
+    void send_updates(const Snapshot& snapshot, float dt);
+    size_t send_budget(HSteamNetConnection conn, float dt);
+    void expire_reservations(float dt);
+    void flush_chat();
+    bool shedding(LoadMode mode) const { return m_governor.mode() >= mode; }
+
+    void send_message_to_all_clients(std::string_view msg, HSteamNetConnection except = k_HSteamNetConnection_Invalid);
+    void send_message_to_client(HSteamNetConnection conn, std::string_view msg);
+    static void encode_chat_message(std::string_view msg, std::vector<uint8_t>& buffer);
+    void send_to_connection(HSteamNetConnection conn, const void* data, uint32 data_size, int k_n_flag);
+    void transmit(ServerStats& stats, HSteamNetConnection conn, const void* data, uint32 data_size, int k_n_flag);
+
+    template <typename T>
+    void send_data(HSteamNetConnection conn, const T data, int k_n_flag);
+    template <typename T>
+    void send_data_to_all_clients(const T data, HSteamNetConnection except, const int k_n_flag = k_nSteamNetworkingSend_Unreliable);
+};
@@ -1,5 +1,7 @@
 #include "game_server.h"
+#include "message_batch.h"
 #include "net_messages.h"
+#include "net_schema.h"
 #include "network_utils.h"
 
 #include <assert.h>
@@ -29,7 +31,15 @@
 
 namespace {
 SteamNetworkingMicroseconds g_logTimeZero;
-uint32_t                    next_player_id = 1;
+
+// A malformed batch counts as something that had to arrive.
+bool only_droppable(const MsgHeader& header, const uint8_t* payload)
+{
+    if (header.type != MsgType::Batch)
+        return is_droppable(header.type);
+    return for_each_batch_record(payload, header.size,
+        [](const MsgHeader& record, const uint8_t*) { return is_droppable(record.type); });
+}
 }
 
 void GameServer::run()
@@ -38,6 +48,10 @@ void GameServer::run()
     // ISteamNetworkingSockets* pInterface = SteamNetworkingSockets();
     m_sockets = SteamNetworkingSockets();
 
+    if (m_checkpoint_path) {
+        restore_checkpoint();
+    }
+
     SteamNetworkingIPAddr server_addr;
     server_addr.Clear();
     server_addr.m_port = m_port;
@@ -57,10 +71,31 @@ void GameServer::run()
 
     printt("\nServer listening on port %d\n", m_port);
 
+    unsigned threads = m_room_threads ? m_room_threads : std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threads; ++i) {
+        m_room_workers.emplace_back([this](std::stop_token stop) { room_worker_loop(stop); });
+        m_send_workers.emplace_back([this](std::stop_token stop) { send_worker_loop(stop); });
+    }
+
+    const auto tick_interval = std::chrono::microseconds(1'000'000 / SERVER_TICK_HZ);
+    const auto start         = std::chrono::steady_clock::now();
+    auto       next_tick     = start + tick_interval;
+
     while (!m_is_quitting) {
+        m_now = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
         poll_incoming_messages();
         poll_connection_state_changes();
         poll_local_user_input();
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_tick) {
+            drop_flooders();
+            schedule_rooms();
+            next_tick += tick_interval;
+            if (next_tick < now) {
+                next_tick = now + tick_interval; // fell behind, don't burst
+            }
+        }
         // std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
 
@@ -77,15 +112,90 @@ void GameServer::init()
     g_logTimeZero = SteamNetworkingUtils()->GetLocalTimestamp();
     SteamNetworkingUtils()->SetDebugOutputFunction(k_ESteamNetworkingSocketsDebugOutputType_Msg, debug_output);
 
+    if (m_net_conditions) {
+        apply_net_conditions(*m_net_conditions);
+    }
+
     local_user_input_init();
 }
 
+void GameServer::init_headless()
+{
+    SteamDatagramErrMsg errMsg;
+    if (!GameNetworkingSockets_Init(nullptr, errMsg)) {
+        fatal_error("GameNetworkingSockets_Init failed! %s", errMsg);
+    }
+
+    g_logTimeZero = SteamNetworkingUtils()->GetLocalTimestamp();
+    SteamNetworkingUtils()->SetDebugOutputFunction(k_ESteamNetworkingSocketsDebugOutputType_Msg, debug_output);
+
+    m_sockets = nullptr;
+}
+
+void GameServer::inject_connected(HSteamNetConnection conn)
+{
+    if (m_map_clients.find(conn) == m_map_clients.end()) {
+        add_client(conn);
+    }
+}
+
+void GameServer::inject_disconnected(HSteamNetConnection conn)
+{
+    auto itClient = m_map_clients.find(conn);
+    if (itClient == m_map_clients.end())
+        return;
+
+    std::string reasonMessage = std::format("{} hath departed", itClient->second.nick);
+    leave_room(conn, reasonMessage);
+    m_map_clients.erase(itClient);
+    m_handshaken.erase(conn);
+
+    if (m_recorder) {
+        m_recorder->record(RecordKind::Disconnected, conn);
+    }
+}
+
+void GameServer::inject_message(HSteamNetConnection conn, const void* data, uint32 size)
+{
+    handle_message(conn, data, size);
+}
+
+void GameServer::drop_client(HSteamNetConnection conn, const std::string& reason)
+{
+    printt("Dropping connection %u: %s\n", conn, reason.c_str());
+
+    leave_room(conn, {});
+    m_map_clients.erase(conn);
+    m_handshaken.erase(conn);
+
+    if (m_recorder) {
+        m_recorder->record(RecordKind::Disconnected, conn);
+    }
+    if (m_sockets) {
+        m_sockets->CloseConnection(conn, 0, reason.c_str(), false);
+    }
+}
+
 void GameServer::shutdown_server()
 {
-    // Step 1: notify clients
+    // Step 1: stop the rooms and notify clients
+    for (std::jthread& worker : m_room_workers) {
+        worker.request_stop();
+    }
+    m_room_jobs_cv.notify_all();
+    m_room_workers.clear(); // joins
+    for (std::jthread& worker : m_send_workers) {
+        worker.request_stop();
+    }
+    m_send_jobs_cv.notify_all();
+    m_send_workers.clear();
+
+    bool checkpointed = m_checkpoint_path && save_checkpoint();
+
     printt("Close connections... \n");
     for (const auto& [conn, client] : m_map_clients) {
-        send_message_to_client(conn, "Server is shutting down. Goodbye.");
+        send_message_to_client(conn, checkpointed ? "Server is restarting; reconnect to carry on."
+                                                  : "Server is shutting down. Goodbye.");
     }
 
     // Step 2: wait until reliable messages are delivered (or timeout)
@@ -119,75 +229,40 @@ void GameServer::shutdown_server()
     }
 
     // Step 5: destroy the library
+    if (m_recorder) {
+        m_recorder->close(); // the process is killed below, flush first
+    }
     GameNetworkingSockets_Kill();
     nuke_process(0);
 }
 
-void GameServer::send_message_to_all_clients(const std::string_view msg, HSteamNetConnection except)
-{
-    for (const auto& [conn, client] : m_map_clients) {
-        if (conn != except) {
-            std::cout << "nick, msg: " << client.nick << " : " << msg << "\n"; // DEBUG_PRINT
-            send_message_to_client(conn, msg);
-        }
-    }
-}
-
 void GameServer::send_message_to_client(HSteamNetConnection conn, std::string_view msg) noexcept
 {
     MsgHeader header;
     header.type = MsgType::ChatMessage;
-    header.size = static_cast<uint32_t>(msg.size());
+    header.size = static_cast<uint16_t>(msg.size());
 
-    std::vector<uint8_t> buffer(sizeof(MsgHeader) + msg.size());
+    std::vector<uint8_t> buffer(MSG_HEADER_SIZE + msg.size());
 
-    memcpy(buffer.data(), &header, sizeof(MsgHeader));
-    memcpy(buffer.data() + sizeof(MsgHeader), msg.data(), msg.size());
+    NetWriter writer(buffer.data(), buffer.size());
+    net_schema::write(writer, header);
+    writer.raw(msg.data(), msg.size());
 
-    m_sockets->SendMessageToConnection(
-        conn,
-        buffer.data(),
-        buffer.size(),
-        k_nSteamNetworkingSend_Reliable,
-        nullptr);
+    send_to_connection(conn, buffer.data(), buffer.size(), k_nSteamNetworkingSend_Reliable);
 }
 
-template <typename T>
-void GameServer::send_data_to_all_clients(const T data, HSteamNetConnection except, const int k_n_flag)
+void GameServer::send_to_connection(HSteamNetConnection conn, const void* data, uint32 data_size, int k_n_flag)
 {
-    MsgHeader header;
-    header.type = MsgTraits<T>::type;
-    header.size = sizeof(T);
-
-    uint8_t buffer[sizeof(MsgHeader) + sizeof(T)];
-    memcpy(buffer, &header, sizeof(header));
-    memcpy(buffer + sizeof(header), &data, sizeof(data));
+    ++m_stats.messages_sent;
+    m_stats.bytes_sent += data_size;
 
-    for (const auto& [conn, client] : m_map_clients) {
-        if (conn != except) {
-            m_sockets->SendMessageToConnection(
-                conn,
-                &buffer,
-                sizeof(buffer),
-                k_n_flag,
-                nullptr);
-        }
+    if (m_recorder) {
+        m_recorder->record(RecordKind::Sent, conn, data, data_size);
     }
-}
 
-template <typename T>
-void GameServer::send_data(HSteamNetConnection conn, const T data, uint32 data_size, int k_n_flag)
-{
-    MsgHeader header;
-    header.type = MsgTraits<T>::type;
-    header.size = sizeof(T);
-
-    uint8_t buffer[sizeof(MsgHeader) + sizeof(T)];
-    memcpy(buffer, &header, sizeof(header));
-    memcpy(buffer + sizeof(header), &data, sizeof(data));
-
-    m_sockets->SendMessageToConnection(conn, &buffer,
-        sizeof(buffer), k_n_flag, nullptr);
+    if (m_sockets) {
+        m_sockets->SendMessageToConnection(conn, data, data_size, k_n_flag, nullptr);
+    }
 }
 
 void GameServer::poll_local_user_input()
@@ -220,160 +295,271 @@ void GameServer::poll_incoming_messages()
         if (num_msgs < 0)
             fatal_error("Server received Error checking for messages!");
         assert(num_msgs == 1 && msg);
+        assert(m_map_clients.find(msg->m_conn) != m_map_clients.end());
 
-        auto it_client = m_map_clients.find(msg->m_conn);
-        assert(it_client != m_map_clients.end());
+        handle_message(msg->m_conn, msg->m_pData, msg->m_cbSize);
 
-        int   size = msg->m_cbSize;
-        void* data = msg->m_pData;
-
-        if (size < sizeof(MsgHeader)) {
-            msg->Release();
-            fatal_error("Server received Invalid packet (too small)\n");
-        }
-
-        MsgHeader header;
-        memcpy(&header, data, sizeof(header));
+        // std::string cmd(reinterpret_cast<const char*>(msg->m_pData), msg->m_cbSize);
+        msg->Release();
+    }
+}
 
-        if (size < sizeof(MsgHeader) + header.size) {
-            msg->Release();
-            fatal_error("Server received Malformed packet (wrong size)\n");
-        }
+void GameServer::handle_message(HSteamNetConnection conn, const void* data, uint32 size)
+{
+    ++m_stats.messages_received;
+    m_stats.bytes_received += size;
 
-        uint8_t* payload = (uint8_t*)data + sizeof(MsgHeader);
+    if (m_recorder) {
+        m_recorder->record(RecordKind::Received, conn, data, size);
+    }
 
-        switch (header.type) {
-        case MsgType::Direction: {
-            if (header.size != sizeof(Direction)) {
-                printt("Server received Invalid dir packet size\n");
-                break;
-            }
+    auto it_client = m_map_clients.find(conn);
+    if (it_client == m_map_clients.end()) {
+        printt("Server received message from unknown connection %u\n", conn);
+        return;
+    }
 
-            Direction dir;
-            memcpy(&dir, payload, sizeof(dir));
+    MsgHeader header;
+    if (!decode_header((const uint8_t*)data, size, header)) {
+        drop_client(conn, "malformed message");
+        return;
+    }
 
-            send_data_to_all_clients(dir, it_client->first);
-            printt("Direction x=%f y=%f\n", dir.x, dir.y);
-        } break;
+    // Rooms apply a batch record by record, so a bad one is caught here,
+    // before any of the records ahead of it take effect.
+    const uint8_t* payload = (const uint8_t*)data + MSG_HEADER_SIZE;
+    if (header.type == MsgType::Batch
+        && !for_each_batch_record(payload, header.size, [](const MsgHeader&, const uint8_t*) { return true; })) {
+        drop_client(conn, "malformed batch");
+        return;
+    }
 
-        case MsgType::ChatMessage: {
-            std::string text((char*)payload, header.size);
-            std::string outgoing_msg = std::format("{}: {}",
-                it_client->second.nick, text);
-            send_message_to_all_clients(outgoing_msg, it_client->first);
-            std::cout << "user_msg: " << outgoing_msg << "\n"; // DEBUG_PRINT
+    if (header.type == MsgType::MsgHello) {
+        MsgHello hello {};
+        if (!decode_payload(payload, header.size, hello) || hello.protocol != PROTOCOL_HASH) {
+            drop_client(conn, std::format("protocol mismatch (client {:08x}, server {:08x})",
+                                  hello.protocol, PROTOCOL_HASH));
+            return;
+        }
+        m_handshaken.try_emplace(conn, CLIENT_MESSAGES_PER_SECOND, CLIENT_MESSAGE_BURST, m_now);
+        return;
+    }
 
-        } break;
+    auto it_handshaken = m_handshaken.find(conn);
+    if (it_handshaken == m_handshaken.end()) {
+        drop_client(conn, "message before hello");
+        return;
+    }
+    if (!it_handshaken->second.take(m_now)) {
+        if (!only_droppable(header, payload)) {
+            drop_client(conn, "flooding");
+            return;
+        }
+        ++m_stats.rate_limited;
+        return;
+    }
 
-        case MsgType::Position: {
-            if (header.size != sizeof(Position)) {
-                printt("Server received Invalid dir packet size\n");
-                break;
-            }
+    if (header.type == MsgType::MsgJoinRoom) {
+        MsgJoinRoom join {};
+        if (!decode_payload(payload, header.size, join) || join.room >= MAX_ROOMS) {
+            drop_client(conn, std::format("no room {}", join.room));
+            return;
+        }
+        join_room(conn, join.room);
+        return;
+    }
 
-            Position pos;
-            memcpy(&pos, payload, sizeof(pos));
-            it_client->second.pos = pos;
+    // Clients that never pick a room play in room 0.
+    auto it_room = m_client_rooms.find(conn);
+    if (it_room == m_client_rooms.end()) {
+        join_room(conn, 0);
+        it_room = m_client_rooms.find(conn);
+    }
+    it_room->second->post_message(conn, data, size);
+}
 
-            MsgPlayerPositionChanged position_changed_msg { it_client->second.id, pos };
-            send_data_to_all_clients(position_changed_msg, it_client->first);
-            // printt("Position x=%f y=%f\n", pos.x, pos.y);
+void GameServer::join_room(HSteamNetConnection conn, uint32_t room_id)
+{
+    auto it_client = m_map_clients.find(conn);
+    if (it_client == m_map_clients.end())
+        return;
 
-        } break;
+    leave_room(conn, std::format("{} hath left for another room", it_client->second.nick));
 
-        case MsgType::MsgPlayerJoined: {
-            if (header.size != sizeof(MsgPlayerJoined)) {
-                printt("Server received Invalid dir packet size\n");
-                break;
-            }
+    GameRoom* room       = open_room(room_id);
+    m_client_rooms[conn] = room;
+    room->post_join(conn, it_client->second.nick);
+}
 
-            MsgInitialState snap;
-            snap.count = 0;
-            for (const auto& [conn, client] : m_map_clients) {
-                if (conn != msg->m_conn) {
-                    Client player;
-                    
-                    memcpy(player.nick, client.nick, sizeof(player.nick));
-                    player.id = client.id;
-                    player.pos = client.pos;
-
-                    snap.clients[snap.count++] = player;
-                }
-            }
-            send_data(msg->m_conn, snap, sizeof(snap),
-                k_nSteamNetworkingSend_Reliable);
+GameRoom* GameServer::open_room(uint32_t room_id)
+{
+    if (room_id >= m_rooms.size()) {
+        m_rooms.resize(room_id + 1);
+    }
+    if (!m_rooms[room_id]) {
+        m_rooms[room_id] = std::make_unique<GameRoom>(room_id, m_sockets, m_recorder, m_client_bytes_per_second,
+            1000.0 / SERVER_TICK_HZ * ROOM_TICK_BUDGET);
+        m_rooms[room_id]->set_position_epsilon(m_position_epsilon);
+        printt("Opened room %u\n", room_id);
+    }
+    return m_rooms[room_id].get();
+}
 
+bool GameServer::save_checkpoint()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<RoomCheckpoint> rooms;
+    size_t                      players = 0;
+    for (const std::unique_ptr<GameRoom>& room : m_rooms) {
+        if (room) {
+            rooms.push_back(room->checkpoint());
+            players += rooms.back().players.size();
+        }
+    }
 
-            MsgPlayerJoined joined_msg;
-            memcpy(&joined_msg, payload, sizeof(joined_msg));
-            joined_msg.id        = next_player_id;
-            it_client->second.id = next_player_id;
+    if (!write_checkpoint(m_checkpoint_path, rooms)) {
+        printt("Failed to write checkpoint %s\n", m_checkpoint_path);
+        return false;
+    }
 
-            MsgPlayerIdAssign assigned_id { next_player_id };
-            send_data(msg->m_conn, assigned_id, sizeof(assigned_id),
-                k_nSteamNetworkingSend_Reliable);
+    printt("Checkpointed %zu rooms, %zu players to %s in %.2f ms\n", rooms.size(), players, m_checkpoint_path,
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return true;
+}
 
-            send_data_to_all_clients(joined_msg, it_client->first,
-                k_nSteamNetworkingSend_Reliable);
-            printt("Player '%d' joined x=%f y=%f\n",
-                joined_msg.id, joined_msg.position.x, joined_msg.position.y);
+void GameServer::restore_checkpoint()
+{
+    auto start = std::chrono::steady_clock::now();
 
+    std::vector<RoomCheckpoint> rooms;
+    if (!read_checkpoint(m_checkpoint_path, rooms)) {
+        printt("No usable checkpoint at %s, starting empty\n", m_checkpoint_path);
+        return;
+    }
 
+    size_t players = 0;
+    for (const RoomCheckpoint& checkpoint : rooms) {
+        if (checkpoint.id >= MAX_ROOMS)
+            continue;
+        open_room(checkpoint.id)->restore(checkpoint);
+        players += checkpoint.players.size();
+    }
 
-            ++next_player_id;
-        } break;
+    printt("Restored %zu rooms, %zu players from %s in %.2f ms\n", rooms.size(), players, m_checkpoint_path,
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
 
-        case MsgType::MsgPlayerLeft: {
-            if (header.size != sizeof(MsgPlayerLeft)) {
-                printt("Server received Invalid dir packet size\n");
-                break;
-            }
+void GameServer::leave_room(HSteamNetConnection conn, std::string_view reason)
+{
+    auto it = m_client_rooms.find(conn);
+    if (it == m_client_rooms.end())
+        return;
 
-            MsgPlayerLeft left_msg;
-            memcpy(&left_msg, payload, sizeof(left_msg));
+    it->second->post_leave(conn, reason);
+    m_client_rooms.erase(it);
+}
 
-            send_data_to_all_clients(left_msg, it_client->first,
-                k_nSteamNetworkingSend_Reliable);
-            printt("Player '%d' left.\n", left_msg.id);
-        } break;
+void GameServer::tick(float dt)
+{
+    m_now += dt;
+    for (const std::unique_ptr<GameRoom>& room : m_rooms) {
+        if (room) {
+            room->update(dt);
+            room->send(dt);
+        }
+    }
+    drop_flooders();
+}
 
-        case MsgType::MsgPlayerPositionChanged: {
-            if (header.size != sizeof(MsgPlayerPositionChanged)) {
-                printt("Client received Invalid MsgPlayerPositionChanged packet size\n");
-                break;
+void GameServer::drop_flooders()
+{
+    for (const std::unique_ptr<GameRoom>& room : m_rooms) {
+        if (!room)
+            continue;
+        for (HSteamNetConnection conn : room->take_flooders()) {
+            if (m_map_clients.contains(conn)) {
+                drop_client(conn, "flooding");
             }
+        }
+    }
+}
 
-            MsgPlayerPositionChanged position_changed_msg;
-            memcpy(&position_changed_msg, payload, sizeof(position_changed_msg));
-
-            printt("Player '%d' position changed x: '%f' y: '%f'.\n",
-                position_changed_msg.id, position_changed_msg.position.x, position_changed_msg.position.y);
-        } break;
-
-        case MsgType::MsgSpawnBullet: {
-            if (header.size != sizeof(MsgSpawnBullet)) {
-                printt("Client received Invalid MsgSpawnBullet packet size\n");
-                break;
+// Queues every room that isn't still busy with the previous tick, so a slow
+// room skips a beat instead of running on two threads.
+void GameServer::schedule_rooms()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_room_jobs_mutex);
+        for (const std::unique_ptr<GameRoom>& room : m_rooms) {
+            if (!room)
+                continue;
+            if (room->m_scheduled.exchange(true)) {
+                ++room->m_missed_ticks;
+            } else {
+                m_room_jobs.push_back(room.get());
             }
+        }
+    }
+    m_room_jobs_cv.notify_all();
+}
 
-            MsgSpawnBullet spawn_bullet_msg;
-            memcpy(&spawn_bullet_msg, payload, sizeof(spawn_bullet_msg));
+void GameServer::room_worker_loop(std::stop_token stop)
+{
+    for (;;) {
+        GameRoom* room;
+        {
+            std::unique_lock<std::mutex> lock(m_room_jobs_mutex);
+            if (!m_room_jobs_cv.wait(lock, stop, [this] { return !m_room_jobs.empty(); }))
+                return;
+            room = m_room_jobs.front();
+            m_room_jobs.pop_front();
+        }
 
-            send_data_to_all_clients(spawn_bullet_msg, it_client->first, k_nSteamNetworkingSend_Unreliable);
+        room->update(1.0f / SERVER_TICK_HZ);
+        room->m_scheduled = false;
+        schedule_send(room);
+    }
+}
 
-            // printt("Player '%d' position changed x: '%f' y: '%f'.\n",
-            //     spawn_bullet_msg.id, spawn_bullet_msg.position.x, spawn_bullet_msg.position.y);
-        } break;
+// A room still sending an older snapshot isn't queued again; it picks up
+// the newest one on its next pass.
+void GameServer::schedule_send(GameRoom* room)
+{
+    if (room->m_sending.exchange(true))
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_send_jobs_mutex);
+        m_send_jobs.push_back(room);
+    }
+    m_send_jobs_cv.notify_one();
+}
 
-        default:
-            printt("Server received Unknown message type\n");
+void GameServer::send_worker_loop(std::stop_token stop)
+{
+    for (;;) {
+        GameRoom* room;
+        {
+            std::unique_lock<std::mutex> lock(m_send_jobs_mutex);
+            if (!m_send_jobs_cv.wait(lock, stop, [this] { return !m_send_jobs.empty(); }))
+                return;
+            room = m_send_jobs.front();
+            m_send_jobs.pop_front();
         }
 
-        // std::string cmd(reinterpret_cast<const char*>(msg->m_pData), msg->m_cbSize);
-        msg->Release();
+        room->send(1.0f / SERVER_TICK_HZ);
+        room->m_sending = false;
+    }
+}
 
-        // std::cout << "user_msg: " << outgoing_msg << "\n"; // DEBUG_PRINT
+ServerStats GameServer::stats() const
+{
+    ServerStats total = m_stats;
+    for (const std::unique_ptr<GameRoom>& room : m_rooms) {
+        if (room)
+            total += room->stats();
     }
+    return total;
 }
 
 // void GameServer::send_direction_data_to_all_other_clients(Direction dir)
@@ -417,12 +603,32 @@ void GameServer::set_client_nick(HSteamNetConnection hConn, std::string_view nic
     // m_map_clients[hConn].nick = std::string(nick);
 
     // Also set the connection name for debugging
-    m_sockets->SetConnectionName(hConn, nick.data());
+    if (m_sockets) {
+        m_sockets->SetConnectionName(hConn, nick.data());
+    }
 }
 
 
 
 
+void GameServer::add_client(HSteamNetConnection hConn)
+{
+    if (m_recorder) {
+        m_recorder->record(RecordKind::Connected, hConn);
+    }
+
+    // Generate a temporary nickname
+    std::string        nick = "BraveWarrior" + std::to_string(10000 + (rand() % 100000));
+    std::ostringstream welcomeMsg;
+    welcomeMsg << "Welcome, stranger. Thou art known as '" << nick
+               << "'; use '/nick' to change.";
+    send_message_to_client(hConn, welcomeMsg.str());
+
+    // Companions are introduced by the room the client joins.
+    m_map_clients[hConn]; // default-construct client entry
+    set_client_nick(hConn, nick);
+}
+
 void GameServer::on_net_connection_status_changed(SteamNetConnectionStatusChangedCallback_t* pInfo)
 {
     assert(pInfo);
@@ -461,10 +667,15 @@ void GameServer::on_net_connection_status_changed(SteamNetConnectionStatusChange
                   << ", reason " << info.m_eEndReason
                   << ": " << info.m_szEndDebug << '\n';
 
+        // Notify everyone else in the room
+        leave_room(pInfo->m_hConn, reasonMessage);
+
         m_map_clients.erase(itClient);
+        m_handshaken.erase(pInfo->m_hConn);
 
-        // Notify everyone else
-        send_message_to_all_clients(reasonMessage);
+        if (m_recorder) {
+            m_recorder->record(RecordKind::Disconnected, pInfo->m_hConn);
+        }
 
         // Close locally
         m_sockets->CloseConnection(pInfo->m_hConn, 0, nullptr, false);
@@ -488,29 +699,7 @@ void GameServer::on_net_connection_status_changed(SteamNetConnectionStatusChange
             return;
         }
 
-        // Generate a temporary nickname
-        std::string        nick = "BraveWarrior" + std::to_string(10000 + (rand() % 100000));
-        std::ostringstream welcomeMsg;
-        welcomeMsg << "Welcome, stranger. Thou art known as '" << nick
-                   << "'; use '/nick' to change.";
-        send_message_to_client(pInfo->m_hConn, welcomeMsg.str());
-
-        if (m_map_clients.empty()) {
-            send_message_to_client(pInfo->m_hConn, "Thou art utterly alone.");
-        } else {
-            send_message_to_client(pInfo->m_hConn,
-                std::format("{} companions greet you:", m_map_clients.size()));
-            for (const auto& [conn, client] : m_map_clients) {
-                send_message_to_client(pInfo->m_hConn, client.nick);
-            }
-        }
-
-        send_message_to_all_clients(
-            std::format("Hark! A stranger hath joined: '{}'", nick),
-            pInfo->m_hConn);
-
-        m_map_clients[pInfo->m_hConn]; // default-construct client entry
-        set_client_nick(pInfo->m_hConn, nick);
+        add_client(pInfo->m_hConn);
         return;
     }
 
@@ -605,9 +794,3 @@ void printt(const char* fmt, ...)
 }
 
 GameServer* GameServer::m_instance = nullptr;
-int         main(int argc, char* argv[])
-{
-    GameServer game_server;
-    game_server.run();
-    return 0;
-}
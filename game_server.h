@@ -1,7 +1,14 @@
 #pragma once
 
+#include "game_room.h"
+#include "net_conditions.h"
 #include "net_messages.h"
+#include "net_recorder.h"
+#include "token_bucket.h"
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <steam/isteamnetworkingsockets.h>
@@ -9,23 +16,82 @@
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 constexpr int PORT = 7776;
 
+// Rooms tick at this rate, each client getting at most its byte budget per
+// second of entity updates (positions, bullets).
+constexpr int      SERVER_TICK_HZ                  = 30;
+constexpr uint32_t DEFAULT_CLIENT_BYTES_PER_SECOND = 48 * 1024;
+constexpr uint32_t MAX_ROOMS                       = 256;
+// Share of a tick one room may spend before it starts shedding load.
+constexpr double ROOM_TICK_BUDGET = 0.5;
+// Messages per second and burst one connection may send the server before
+// it is handed to a room; the rooms then limit each record type on its own.
+// Past it, a message of nothing but droppable records (see is_droppable) is
+// dropped and any other disconnects the client.
+constexpr float CLIENT_MESSAGES_PER_SECOND = 500.0f;
+constexpr float CLIENT_MESSAGE_BURST       = 250.0f;
+
 class GameServer {
 public:
     void run();
+    void set_recorder(NetRecorder* recorder) { m_recorder = recorder; }
+    void set_net_conditions(const NetConditions* conditions) { m_net_conditions = conditions; }
+    void set_client_bandwidth(uint32_t bytes_per_second) { m_client_bytes_per_second = bytes_per_second; }
+    void set_room_threads(unsigned threads) { m_room_threads = threads; }
+    void set_position_epsilon(float pixels) { m_position_epsilon = pixels; }
+    // Restored from on start if present, written on shutdown.
+    void set_checkpoint_path(const char* path) { m_checkpoint_path = path; }
+
+    // Updates every room once on the calling thread, then sends. run()
+    // instead hands rooms to the pools at SERVER_TICK_HZ.
+    void tick(float dt);
+
+    // Headless mode, used by the replay tool: no sockets are created and
+    // sends are only counted. Connections and messages are fed in by hand.
+    void init_headless();
+    void inject_connected(HSteamNetConnection conn);
+    void inject_disconnected(HSteamNetConnection conn);
+    void inject_message(HSteamNetConnection conn, const void* data, uint32 size);
+
+    ServerStats stats() const; // only while no room is updating
 
 private:
 
-    std::unordered_map<HSteamNetConnection, Client> m_map_clients;
+    // Every connection, by nick; game state lives in the rooms.
+    std::unordered_map<HSteamNetConnection, Client>      m_map_clients;
+    std::unordered_map<HSteamNetConnection, TokenBucket> m_handshaken; // sent a matching MsgHello, with its message limit
+    std::unordered_map<HSteamNetConnection, GameRoom*>   m_client_rooms;
+    std::vector<std::unique_ptr<GameRoom>>               m_rooms; // by id, created on first join
 
     static GameServer* m_instance;
     const uint16       m_port { PORT };
 
-    ISteamNetworkingSockets* m_sockets;
-    HSteamNetPollGroup       m_poll_group;
-    HSteamListenSocket       m_listen_socket;
+    ISteamNetworkingSockets* m_sockets {};
+    HSteamNetPollGroup       m_poll_group { k_HSteamNetPollGroup_Invalid };
+    HSteamListenSocket       m_listen_socket { k_HSteamListenSocket_Invalid };
+    NetRecorder*             m_recorder {};
+    const NetConditions*     m_net_conditions {};
+    ServerStats              m_stats;
+    uint32_t                 m_client_bytes_per_second { DEFAULT_CLIENT_BYTES_PER_SECOND };
+    unsigned                 m_room_threads {};
+    float                    m_position_epsilon { DEFAULT_POSITION_EPSILON };
+    const char*              m_checkpoint_path {};
+    double                   m_now {}; // seconds, for the rate limits; tick() advances it headless
+
+    std::mutex                  m_room_jobs_mutex;
+    std::condition_variable_any m_room_jobs_cv;
+    std::deque<GameRoom*>       m_room_jobs;
+    std::vector<std::jthread>   m_room_workers;
+
+    // A room goes here after each update(), to send from its snapshot
+    // while the room pool moves on to the next tick.
+    std::mutex                  m_send_jobs_mutex;
+    std::condition_variable_any m_send_jobs_cv;
+    std::deque<GameRoom*>       m_send_jobs;
+    std::vector<std::jthread>   m_send_workers;
     
     std::queue<std::string>  m_queueUserInput;
     std::atomic<bool>        m_is_quitting { false };
@@ -34,10 +100,23 @@ private:
 
     void init();
     void shutdown_server();
-    void send_message_to_all_clients(const std::string_view msg, HSteamNetConnection except = k_HSteamNetConnection_Invalid);
     void send_message_to_client(HSteamNetConnection conn, std::string_view msg) noexcept;
     void poll_local_user_input();
     void poll_incoming_messages();
+    void handle_message(HSteamNetConnection conn, const void* data, uint32 size);
+    void join_room(HSteamNetConnection conn, uint32_t room_id);
+    void leave_room(HSteamNetConnection conn, std::string_view reason);
+    GameRoom* open_room(uint32_t room_id);
+    bool save_checkpoint();
+    void restore_checkpoint();
+    void schedule_rooms();
+    void drop_flooders();
+    void room_worker_loop(std::stop_token stop);
+    void schedule_send(GameRoom* room);
+    void send_worker_loop(std::stop_token stop);
+    void add_client(HSteamNetConnection conn);
+    void drop_client(HSteamNetConnection conn, const std::string& reason);
+    void send_to_connection(HSteamNetConnection conn, const void* data, uint32 data_size, int k_n_flag);
     bool is_all_reliable_messages_sent(ISteamNetworkingSockets* sockets, const std::unordered_map<HSteamNetConnection, Client>& clients);
     void set_client_nick(HSteamNetConnection hConn, std::string_view nick);
     void on_net_connection_status_changed(SteamNetConnectionStatusChangedCallback_t* pInfo);
@@ -45,15 +124,6 @@ private:
     void local_user_input_init();
     bool local_user_input_get_next(std::string& result);
 
-    // void send_direction_data_to_all_other_clients(Direction dir);
-    template<typename T>
-    void send_data_to_all_clients(const T data, HSteamNetConnection except, const int k_n_flag=k_nSteamNetworkingSend_Unreliable);
-    // void send_data_to_client(HSteamNetConnection conn, const Direction dir) noexcept;
-    template<typename T>
-    void send_data(HSteamNetConnection conn, const T data, uint32 data_size, int k_n_flag);
-
-    // void send_data(HSteamNetConnection conn, const void* data, uint32 data_size, int k_n_flag);
-
 
     static void net_connection_status_changed_callback(SteamNetConnectionStatusChangedCallback_t* pInfo)
     {
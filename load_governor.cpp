@@ -0,0 +1,41 @@
+#include "load_governor.h"
+
+const char* load_mode_name(LoadMode mode)
+{
+    switch (mode) {
+    case LoadMode::Normal:
+        return "normal";
+    case LoadMode::ThinFar:
+        return "thin-far";
+    case LoadMode::DropCosmetic:
+        return "drop-cosmetic";
+    case LoadMode::CoalesceChat:
+        return "coalesce-chat";
+    }
+    return "?";
+}
+
+bool LoadGovernor::observe(double tick_ms, uint32_t missed)
+{
+    // Smoothed over roughly ten ticks, so one slow tick (a page fault, a
+    // big join) doesn't count as load.
+    m_load += (tick_ms / m_budget_ms - m_load) * 0.1;
+
+    bool over = missed > 0 || m_load > 1.0;
+    bool calm = missed == 0 && m_load < CALM_FRACTION;
+
+    m_over = over ? m_over + 1 : 0;
+    m_calm = calm ? m_calm + 1 : 0;
+
+    if (m_over >= ESCALATE_TICKS && m_mode != LoadMode::CoalesceChat) {
+        m_mode = static_cast<LoadMode>(static_cast<uint8_t>(m_mode) + 1);
+        m_over = 0;
+        return true;
+    }
+    if (m_calm >= RECOVER_TICKS && m_mode != LoadMode::Normal) {
+        m_mode = static_cast<LoadMode>(static_cast<uint8_t>(m_mode) - 1);
+        m_calm = 0;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+// Ordered from normal to most degraded; each mode keeps the ones before it.
+enum class LoadMode : uint8_t {
+    Normal,
+    ThinFar,      // far entity updates only every FAR_UPDATE_INTERVAL ticks
+    DropCosmetic, // no Direction relays or join/leave flavor text
+    CoalesceChat, // chat goes out once per tick as one message per client
+};
+
+const char* load_mode_name(LoadMode mode);
+
+// Watches how long a room's ticks take against its budget and steps the
+// room through LoadMode. One level at a time in both directions: up after
+// a few overrunning ticks in a row, down only after a long calm stretch, so
+// a borderline load doesn't flap.
+class LoadGovernor {
+public:
+    static constexpr int    ESCALATE_TICKS = 5;   // consecutive overruns
+    static constexpr int    RECOVER_TICKS  = 90;  // consecutive calm ticks, 3 s at 30 Hz
+    static constexpr double CALM_FRACTION  = 0.6; // of the budget
+
+    explicit LoadGovernor(double budget_ms)
+        : m_budget_ms(budget_ms)
+    {
+    }
+
+    // `missed` is how many ticks the scheduler skipped because the room
+    // was still busy; any count as an overrun. True if the mode changed.
+    bool observe(double tick_ms, uint32_t missed);
+
+    LoadMode mode() const { return m_mode; }
+    double   load() const { return m_load; } // smoothed tick time over budget
+
+private:
+    double   m_budget_ms;
+    double   m_load {};
+    int      m_over {};
+    int      m_calm {};
+    LoadMode m_mode { LoadMode::Normal };
+};
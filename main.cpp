@@ -33,15 +33,27 @@
 #include <flecs/addons/cpp/mixins/pipeline/decl.hpp>
 #include <flecs/addons/cpp/world.hpp>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <iostream>
+#include <thread>
+#include <vector>
 #include <steam/steamnetworkingtypes.h>
 
-#define STB_IMAGE_IMPLEMENTATION
+#include "asset_loader.h"
+#include "asset_pack.h"
+#include "bullet_kernel.h"
+#include "entity_table.h"
+#include "frame_profiler.h"
 #include "game_client.h"
 #include "net_messages.h"
-#include "stb_image.h"
+#include "net_schema.h"
+#include "net_task.h"
+#include "render_components.h"
+#include "sim.h"
+#include "spatial_grid.h"
+#include "world_streamer.h"
 
 #define FLECS_CPP
 
@@ -52,36 +64,25 @@ constexpr float WORLD_VIEW_WIDTH  = 20.0f;
 constexpr float WORLD_VIEW_HEIGHT = 12.0f;
 constexpr float GRID_SIZE         = 100.0f; // 1 world unit per cell
 
-constexpr int DEFAULT_PLAYER_SIZE { 128 };
-
-constexpr float BASE_PLAYER_SPEED { 250 };
-constexpr float BASE_PLAYER_HEALTH { 100 };
-
-constexpr float BASE_BULLET_SPEED { 500 };
-constexpr float BASE_BULLET_DAMAGE { 5 };
-constexpr float BASE_BULLET_RANGE { 500 };
-
 void        sdl_init();
 void        set_app_metadata();
 void        get_error();
-void        createTexture(SDL_Texture** texture, int& width, int& height, const char* textureFileName);
 const char* dptf_name = "hey_small.png";
 const char* dbtf_name = "bullet_14x14.png";
 
 SDL_Window*   m_window {};
 SDL_Renderer* m_renderer {};
 TTF_Font*     m_font = nullptr;
+AssetPack     m_assets;
+AssetLoader   m_loader;
+WorldStreamer m_world;
 GameClient    m_game_client;
+FrameProfiler m_profiler;
+bool          m_joining {}; // join_game() is between connect and id
 
 int m_window_w = WINDOW_WIDTH;
 int m_window_h = WINDOW_HEIGHT;
 
-template <typename T>
-T normalize_vector(T vec);
-
-template <typename T>
-float get_vector_length(T vec);
-
 template <typename T>
 void send_data(T data, const int k_n_flag);
 
@@ -90,7 +91,10 @@ SDL_Texture* get_font_texture(SDL_Renderer* renderer, const char* message, SDL_C
 flecs::entity create_player(flecs::world ecs, uint32_t id, const char* texture_file_name, Position position, float speed, Health health, bool is_local);
 void          create_bullet(flecs::world ecs, const char* texture_file_name, Position position, Direction direction, Speed speed, Damage damage, Range range, bool is_local);
 
+void set_texture_when_ready(flecs::entity e, const char* texture_file_name);
+
 bool is_in_camera_view(const Camera& cam, const Position obj_position, const float obj_width, const float obj_height);
+void draw_grid_lines(const Camera& cam, float scaleX, float scaleY);
 void poll_keyboard_state(flecs::entity player);
 void update_physics(const float dt);
 
@@ -99,14 +103,63 @@ void render_font(const char* message, float rect_x, float rect_y);
 
 void send_direction_and_position_data_to_server(Direction dir, Position pos);
 void disconnect_from_server(flecs::entity player);
+void clear_remote_players();
+NetTask join_game(flecs::entity player);
 
-std::unordered_map<uint32, flecs::entity> m_players_by_id;
+EntityTable<flecs::entity>                m_players_by_id; // remote and local players by server id
+SpatialGrid                               m_grid;
 
 int main(int argc, char* argv[])
 {
     flecs::world ecs;
+    ecs.set_threads(std::max(1u, std::thread::hardware_concurrency()));
+
+    // Baked by asset_bake next to the executable. Without it textures and
+    // fonts are decoded from their source files on the loader threads.
+    char* pack_path {};
+    SDL_asprintf(&pack_path, "%sassets.pak", SDL_GetBasePath());
+    if (!m_assets.open(pack_path)) {
+        SDL_Log("No asset pack at %s, decoding source assets", pack_path);
+    }
+    SDL_free(pack_path);
+
+    // Baked by world_bake next to the executable; without it the ground is
+    // just the grid.
+    char* world_path {};
+    SDL_asprintf(&world_path, "%sworld.bin", SDL_GetBasePath());
+    if (!m_world.open(world_path)) {
+        SDL_Log("No world at %s, drawing the grid", world_path);
+    }
+    SDL_free(world_path);
 
     sdl_init();
+
+    ecs.observer<GridCell>()
+        .event(flecs::OnRemove)
+        .each([](flecs::entity e, GridCell& cell) {
+            if (cell.placed) {
+                m_grid.remove(e.id(), cell);
+                cell.placed = false;
+            }
+        });
+
+    bool connect_on_start = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--connect")) {
+            connect_on_start = true;
+        } else if (!strcmp(argv[i], "--net-thread")) {
+            m_game_client.set_network_thread(true);
+        } else if (!strcmp(argv[i], "--netsim") && i + 1 < argc) {
+            const NetConditions* conditions = find_net_conditions(argv[++i]);
+            if (conditions) {
+                m_game_client.set_net_conditions(conditions);
+            } else {
+                print_net_conditions_profiles();
+            }
+        } else if (!strcmp(argv[i], "--room") && i + 1 < argc) {
+            m_game_client.set_room(static_cast<uint32_t>(atoi(argv[++i])));
+        }
+    }
     m_game_client.init();
     m_game_client.on_player_joined = [&](uint32_t id, Position pos) {
         std::cout << "Getting joining ...\n";
@@ -123,13 +176,23 @@ int main(int argc, char* argv[])
 
     m_game_client.on_player_left = [&](uint32_t id) {
         std::cout << "Player " << id << " leaving.\n";
-        auto player = m_players_by_id[id];
-        SDL_DestroyTexture(player.get_mut<Texture>().texture);
-        player.destruct();
+        flecs::entity* player = m_players_by_id.find(id);
+        if (!player) {
+            std::cout << "Player " << id << " left, but was never seen.\n";
+            return;
+        }
+        player->destruct();
         m_players_by_id.erase(id);
         std::cout << "Player " << id << " left.\n";
     };
 
+    // Whoever was around is gone with the connection; a rejoin sends them
+    // again in MsgInitialState.
+    m_game_client.on_disconnected = [&]() {
+        std::cout << "Disconnected from server.\n";
+        clear_remote_players();
+    };
+
     m_game_client.on_player_id_assigned = [&](uint32_t id) {
         std::cout << "Player id assigning ...\n";
         auto local_player_entity = ecs.lookup("LocalPlayer");
@@ -139,29 +202,33 @@ int main(int argc, char* argv[])
         m_players_by_id.insert_or_assign(id, local_player_entity);
     };
 
-    m_game_client.on_player_position_changed = [&](uint32_t id, Position pos) {
-        auto player = m_players_by_id[id];
-        player.assign<Position>({ pos });
-        RectF r = player.get<RectF>();
-        player.assign<RectF>({ pos.x - r.rect.w * 0.5f,
-            pos.y - r.rect.h * 0.5f,
-            r.rect.w,
-            r.rect.h });
+    m_game_client.on_player_positions_changed = [&](const std::vector<MsgPlayerPositionChanged>& updates) {
+        // Updates for players we haven't heard join yet are dropped; the
+        // next one after MsgPlayerJoined lands.
+        m_players_by_id.apply(updates, [](flecs::entity player, const MsgPlayerPositionChanged& update) {
+            Position pos = update.position;
+            player.assign<Position>({ pos });
+            RectF r = player.get<RectF>();
+            player.assign<RectF>({ pos.x - r.rect.w * 0.5f,
+                pos.y - r.rect.h * 0.5f,
+                r.rect.w,
+                r.rect.h });
+        });
     };
 
-    m_game_client.on_players_initial_state_sent = [&](uint32_t count, Client clients[8]) {
+    m_game_client.on_players_initial_state_sent = [&](const std::vector<Client>& clients) {
         std::cout << "Getting initial state ...\n";
-        for (int i = 0; i < count; ++i) {
-            std::cout << "Getting player " << clients[i].id << "\n";
+        for (const Client& client : clients) {
+            std::cout << "Getting player " << client.id << "\n";
             auto player = create_player(ecs,
-                clients[i].id,
+                client.id,
                 dptf_name,
-                clients[i].pos,
+                client.pos,
                 BASE_PLAYER_SPEED,
                 Health { BASE_PLAYER_HEALTH },
                 false);
-            m_players_by_id.insert_or_assign(clients[i].id, player);
-            std::cout << "Player " << clients[i].id << " in the server.\n";
+            m_players_by_id.insert_or_assign(client.id, player);
+            std::cout << "Player " << client.id << " in the server.\n";
         }
     };
 
@@ -177,12 +244,17 @@ int main(int argc, char* argv[])
         Health { BASE_PLAYER_HEALTH },
         true);
 
+    // The handshake runs while the first frames stream textures in.
+    if (connect_on_start) {
+        join_game(player_entity);
+    }
+
     auto camera_entity = ecs.entity("Camera")
                              .set<Camera>({ 0.0f, 0.0f,
                                  WORLD_VIEW_WIDTH,
                                  WORLD_VIEW_HEIGHT });
 
-    ecs.system<Position, RectF, LocalPlayer>()
+    ecs.system<Position, RectF, LocalPlayer>("FollowCamera")
         .kind(flecs::PreUpdate)
         .each([&, camera_entity](flecs::iter it, size_t row, Position p, RectF r, LocalPlayer) {
             flecs::entity e = it.entity(row);
@@ -192,112 +264,111 @@ int main(int argc, char* argv[])
             camera_entity.assign<Camera>(cam);
         });
 
-    flecs::system player_physics
-        = ecs.system<Position, Direction, Speed, PlayerTag>()
-              .kind(0) // flecs::OnValidate, flecs::PostUpdate
-              .each([](flecs::iter& it, size_t row, Position& p, Direction& d, Speed s, PlayerTag) {
-                  flecs::entity e = it.entity(row);
-                  if (e.has<LocalPlayer>()) {
-                      p.x += d.x * s.speed * it.delta_time();
-                      p.y += d.y * s.speed * it.delta_time();
-                  }
-              });
-
-    flecs::system bullet_physics
-        = ecs.system<Position, Direction, Speed, Range, RectF, BulletTag>()
-              .kind(0)
-              .each([](flecs::iter it, size_t i, Position& p, Direction d, Speed s, Range& range, RectF& r, BulletTag) {
-                  if (range.value > 0) {
-                      p.x += d.x * s.speed * it.delta_time();
-                      p.y += d.y * s.speed * it.delta_time();
-
-                      range.value -= s.speed * it.delta_time();
-
-                      r.rect.x = p.x - r.rect.w * 0.5f;
-                      r.rect.y = p.y - r.rect.h * 0.5f;
-                  } else {
-                      SDL_DestroyTexture(it.entity(i).get_mut<Texture>().texture);
-                      it.entity(i).destruct();
-                  }
-
-                  // std::cout << "Bullet Range left: " << range.value << "\n";
-                  // std::cout << "Bullet Speed: " << s.speed << "\n";
-                  // std::cout << "Bullet Px Py: " << p.x << ", " << p.y << "\n";
-                  // std::cout << "Bullet delta time: " << it.delta_time() << "\n";
-                  // std::cout << "Bullet Dx Dy: " << d.x << ", " << d.y << "\n";
-              });
-
-    ecs.system<Position, RectF, Texture>()
-        .kind(flecs::OnStore)
-        .each([camera_entity](flecs::iter& it, size_t row, Position p, RectF r, Texture t) {
-            flecs::entity e = it.entity(row);
-            if (e.has<LocalPlayer>()) {
-                r.rect.x = m_window_w * 0.5f - r.rect.w * 0.5f;
-                r.rect.y = m_window_h * 0.5f - r.rect.h * 0.5f;
+    SimSystems sim = sim_init(ecs);
+    SDL_Log("Bullet kernel: %s", bullet_kernel_name(select_bullet_kernel()));
+
+    // The spatial grid is kept up to date incrementally: workers compute each
+    // entity's cell and only report the ones that crossed a cell boundary,
+    // which the main thread then re-files before rendering.
+    struct GridMove {
+        flecs::entity_t id;
+        GridCell        from;
+        GridCell        to;
+        float           half_w;
+        float           half_h;
+    };
+    std::vector<std::vector<GridMove>> grid_moves(ecs.get_stage_count());
+
+    ecs.system<const Position, const RectF, GridCell>("UpdateGridCells")
+        .kind(flecs::PostUpdate)
+        .multi_threaded()
+        .each([&grid_moves](flecs::iter& it, size_t row, const Position& p, const RectF& r, GridCell& cell) {
+            GridCell now = m_grid.cell_of(p.x, p.y);
+            if (cell.placed && cell.x == now.x && cell.y == now.y)
+                return;
+
+            grid_moves[it.world().get_stage_id()].push_back(
+                { it.entity(row).id(), cell, now, r.rect.w * 0.5f, r.rect.h * 0.5f });
+            cell = now;
+        });
+
+    ecs.system("ApplyGridMoves")
+        .kind(flecs::PreStore)
+        .run([&ecs, &grid_moves](flecs::iter&) {
+            for (std::vector<GridMove>& moves : grid_moves) {
+                for (const GridMove& m : moves) {
+                    if (!ecs.is_alive(m.id)) {
+                        if (m.from.placed)
+                            m_grid.remove(m.id, m.from);
+                    } else if (m.from.placed) {
+                        m_grid.move(m.id, m.from, m.to);
+                    } else {
+                        m_grid.insert(m.id, m.to, m.half_w, m.half_h);
+                    }
+                }
+                moves.clear();
             }
+        });
+
+    // Everything below touches the renderer and stays on the main thread.
+    ecs.system<const Camera>("DrawGround")
+        .term_at(0)
+        .src(camera_entity)
+        .kind(flecs::OnStore)
+        .each([](const Camera& cam) {
+            float scaleX = (float)m_window_w / cam.w;
+            float scaleY = (float)m_window_h / cam.h;
 
-            Camera cam = camera_entity.get<Camera>();
+            if (m_world.is_open()) {
+                m_world.render(m_renderer, cam, scaleX, scaleY);
+            } else {
+                draw_grid_lines(cam, scaleX, scaleY);
+            }
 
             std::string message_to_render = "Px: " + std::to_string(cam.x) + "   Py: " + std::to_string(cam.y);
             render_font(message_to_render.c_str(), 100.0f, 100.0f);
 
-            float camLeft   = cam.x;
-            float camRight  = cam.x + cam.w;
-            float camTop    = cam.y;
-            float camBottom = cam.y + cam.h;
-
-            int startX = (int)std::floor(camLeft / GRID_SIZE);
-            int endX   = (int)std::ceil(camRight / GRID_SIZE);
-
-            int startY = (int)std::floor(camTop / GRID_SIZE);
-            int endY   = (int)std::ceil(camBottom / GRID_SIZE);
+            SDL_SetRenderDrawColor(m_renderer, 100, 20, 20, 255);
+        });
 
+    // Only the cells overlapping the camera are visited, so the cost of this
+    // pass follows what is on screen rather than the size of the world.
+    ecs.system<const Camera>("RenderVisible")
+        .term_at(0)
+        .src(camera_entity)
+        .kind(flecs::OnStore)
+        .each([&ecs, player_entity](const Camera& cam) {
             float scaleX = (float)m_window_w / cam.w;
             float scaleY = (float)m_window_h / cam.h;
 
-            SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 100);
-            for (int x = startX; x <= endX; ++x) {
-                float worldX = x * GRID_SIZE;
+            m_grid.query(cam.x, cam.y, cam.w, cam.h, [&](uint64_t id) {
+                if (id == player_entity.id())
+                    return;
 
-                float screenX = (worldX - cam.x) * scaleX;
+                flecs::entity  e = flecs::entity(ecs, id);
+                const RectF&   r = e.get<RectF>();
+                const Texture& t = e.get<Texture>();
+                if (!is_in_camera_view(cam, e.get<Position>(), r.rect.w, r.rect.h))
+                    return;
 
-                SDL_RenderLine(
-                    m_renderer,
-                    (int)screenX, 0,
-                    (int)screenX, m_window_h);
-            }
-
-            for (int y = startY; y <= endY; ++y) {
-                float worldY = y * GRID_SIZE;
-
-                float screenY = (worldY - cam.y) * scaleY;
-
-                SDL_RenderLine(
-                    m_renderer,
-                    0, (int)screenY,
-                    m_window_w, (int)screenY);
-            }
-
-            if (is_in_camera_view(cam, p, r.rect.w, r.rect.h)) {
-                float     scaleX = (float)m_window_w / cam.w;
-                float     scaleY = (float)m_window_h / cam.h;
                 SDL_FRect screenRect {
                     (r.rect.x - cam.x) * scaleX,
                     (r.rect.y - cam.y) * scaleY,
                     r.rect.w * scaleX,
                     r.rect.h * scaleY
                 };
-
-                if (!e.has<LocalPlayer>()) {
-                    SDL_RenderTexture(m_renderer, t.texture, nullptr, &screenRect);
-                }
-            }
-
-            if (e.has<LocalPlayer>()) {
-                SDL_RenderTexture(m_renderer, t.texture, nullptr, &r.rect); //&player.rect
-            }
-
-            SDL_SetRenderDrawColor(m_renderer, 100, 20, 20, 255);
+                SDL_RenderTexture(m_renderer, t.texture, nullptr, &screenRect);
+            });
+
+            // The local player is pinned to the middle of the window.
+            const RectF& r = player_entity.get<RectF>();
+            SDL_FRect    playerRect {
+                m_window_w * 0.5f - r.rect.w * 0.5f,
+                m_window_h * 0.5f - r.rect.h * 0.5f,
+                r.rect.w,
+                r.rect.h
+            };
+            SDL_RenderTexture(m_renderer, player_entity.get<Texture>().texture, nullptr, &playerRect);
         });
 
     // auto          players = ecs.query<PlayerId>();
@@ -310,7 +381,7 @@ int main(int argc, char* argv[])
 
     bool isAppRunning = true;
 
-    constexpr float fixed_dt    = 1.0f / 60.0f;
+    constexpr float fixed_dt    = SIM_FIXED_DT;
     const int       MAX_STEPS   = 5;
     float           accumulator = 0.0f;
 
@@ -324,22 +395,28 @@ int main(int argc, char* argv[])
         dt = std::min(dt, 0.25f);
         accumulator += dt;
 
+        m_profiler.begin_frame();
+
+        m_profiler.stage_begin(FrameStage::Physics);
         int steps = 0;
         while (accumulator >= fixed_dt && steps < MAX_STEPS) {
-            player_physics.run(fixed_dt);
-            bullet_physics.run(fixed_dt);
+            sim_step(ecs, sim, fixed_dt);
             accumulator -= fixed_dt;
             ++steps;
         }
+        m_profiler.stage_end(FrameStage::Physics);
         float rendering_alpha = accumulator / fixed_dt;
 
         SDL_Event event {};
+        m_profiler.stage_begin(FrameStage::Keyboard);
         poll_keyboard_state(player_entity);
+        m_profiler.stage_end(FrameStage::Keyboard);
 
-        if (m_game_client.m_is_connected) {
-            m_game_client.parse_incoming_messages();
-        }
+        m_profiler.stage_begin(FrameStage::Network);
+        m_game_client.poll();
+        m_profiler.stage_end(FrameStage::Network);
 
+        m_profiler.stage_begin(FrameStage::Events);
         while (SDL_PollEvent(&event)) {
 
             switch (event.type) {
@@ -369,16 +446,15 @@ int main(int argc, char* argv[])
                     break;
                 }
 
-                case SDLK_F2: {
-                    if (!m_game_client.m_is_connected) {
-                        m_game_client.connect();
+                case SDLK_F3:
+                    m_profiler.toggle(ecs);
+                    break;
 
-                        MsgPlayerJoined msg;
-                        msg.id       = player_entity.get<PlayerId>().playerId;
-                        msg.position = player_entity.get<Position>();
-                        send_data(msg, k_nSteamNetworkingSend_Reliable);
-                    } else {
+                case SDLK_F2: {
+                    if (m_game_client.m_is_connected) {
                         disconnect_from_server(player_entity);
+                    } else if (!m_joining) {
+                        join_game(player_entity);
                     }
                 }
 
@@ -432,6 +508,15 @@ int main(int argc, char* argv[])
                 break;
             }
         }
+        m_profiler.stage_end(FrameStage::Events);
+
+        // Everything the frame queued (movement, bullets, join/leave) goes
+        // out as one message per reliability class.
+        m_profiler.stage_begin(FrameStage::Network);
+        if (m_game_client.m_is_connected) {
+            m_game_client.flush_outbound();
+        }
+        m_profiler.stage_end(FrameStage::Network);
 
         // Render(rendering_alpha)
         // renderPos = currPos * rendering_alpha + prevPos * (1 - rendering_alpha) ;
@@ -440,35 +525,41 @@ int main(int argc, char* argv[])
         // alpha = 0.5 → halfway to next physics state
         // alpha = 0.99 → almost at next physics state
 
+        m_profiler.stage_begin(FrameStage::Render);
+        m_loader.pump(2.0);
+        m_world.update(camera_entity.get<Camera>());
         SDL_RenderClear(m_renderer);
         ecs.progress(dt);
+        m_profiler.stage_end(FrameStage::Render);
+
+        m_profiler.render(m_renderer, m_font, m_window_w, m_window_h);
+
+        m_profiler.stage_begin(FrameStage::Present);
         SDL_RenderPresent(m_renderer);
+        m_profiler.stage_end(FrameStage::Present);
 
         // RENDER TOP
         // SDL_RenderFillRect(m_renderer, &topRect);
         // SDL_SetRenderDrawColor(m_renderer, 50, 20, 20, 255);
 
         SDL_GetWindowSizeInPixels(m_window, &m_window_w, &m_window_h);
-    }
-
-    SDL_DestroyTexture(player_entity.get_mut<Texture>().texture);
 
-    ecs.query<Texture>().each([](flecs::entity e, Texture& t) {
-        if (t.texture) {
-            SDL_DestroyTexture(t.texture);
-            t.texture = nullptr; // good practice to avoid dangling pointer
-        }
-    });
+        m_profiler.end_frame(ecs);
+    }
 
     if (m_game_client.m_is_connected) {
         disconnect_from_server(player_entity);
     }
 
+    m_profiler.clear_text();
+    TTF_CloseFont(m_font);
+    m_loader.shutdown(); // owns every texture and the font bytes
+    m_world.shutdown();
     SDL_DestroyRenderer(m_renderer);
     SDL_DestroyWindow(m_window);
 
-    TTF_CloseFont(m_font);
     TTF_Quit();
+    m_assets.close();
 
     if (SDL_WasInit(SDL_INIT_VIDEO)) {
         SDL_GL_UnloadLibrary();
@@ -485,100 +576,99 @@ bool load_font()
         get_error();
         return false;
     }
-    m_font = TTF_OpenFont("fonts/roboto.ttf", 32);
-    if (!m_font) {
-        SDL_Log("%s", "Couldnt load the font!");
-        return false;
-    }
+    // Text is skipped until the font arrives.
+    m_loader.request_file("fonts/roboto.ttf", [](const uint8_t* data, size_t size) {
+        m_font = TTF_OpenFontIO(SDL_IOFromConstMem(data, size), true, 32);
+        if (!m_font) {
+            SDL_Log("%s", "Couldnt load the font!");
+        }
+    });
     return true;
 }
 
 void create_bullet(flecs::world ecs, const char* texture_file_name, Position pos, Direction dir, Speed speed, Damage damage, Range range, bool isLocal)
 {
-    int          tex_w {};
-    int          tex_h {};
-    SDL_Texture* texture {};
-    createTexture(&texture, tex_w, tex_h, texture_file_name);
-
-    if (isLocal)
-        ecs.entity()
-            .add<BulletTag>()
-            .add<LocalBullet>()
-            .set<Speed>(speed)
-            .set<Texture>({ texture })
-            .set<Position>(pos)
-            .set<Direction>(dir)
-            .set<Damage>(damage)
-            .set<Range>(range)
-            .set<RectF>({ pos.x - tex_w / 2.0f,
-                pos.y - tex_h / 2.0f,
-                static_cast<float>(tex_w),
-                static_cast<float>(tex_h) });
-    else
-        ecs.entity()
-            .add<BulletTag>()
-            .add<Direction>()
-            .set<Speed>(speed)
-            .set<Texture>({ texture })
-            .set<Position>(pos)
-            .set<Direction>(dir)
-            .set<Damage>(damage)
-            .set<Range>(range)
-            .set<RectF>({ pos.x - tex_w / 2.0f,
-                pos.y - tex_h / 2.0f,
-                static_cast<float>(tex_w),
-                static_cast<float>(tex_h) });
+    flecs::entity bullet = spawn_bullet(ecs, pos, dir, speed, damage, range, isLocal,
+        DEFAULT_BULLET_SIZE, DEFAULT_BULLET_SIZE);
+    bullet.set<Texture>({ m_loader.placeholder() }).add<GridCell>();
+    set_texture_when_ready(bullet, texture_file_name);
 }
 
 flecs::entity create_player(flecs::world ecs, uint32_t id, const char* texture_file_name, Position position, float speed, Health health, bool isLocal)
 {
+    flecs::entity player = spawn_player(ecs, id, position, speed, health, isLocal,
+        DEFAULT_PLAYER_SIZE, DEFAULT_PLAYER_SIZE);
+    player.set<Texture>({ m_loader.placeholder() }).add<GridCell>();
+    set_texture_when_ready(player, texture_file_name);
+    return player;
+}
 
-    int          tex_w {};
-    int          tex_h {};
-    SDL_Texture* texture {};
-    createTexture(&texture, tex_w, tex_h, texture_file_name);
-    flecs::entity player;
-
-    if (isLocal)
-        player = ecs.entity("LocalPlayer")
-                     .add<PlayerTag>()
-                     .add<LocalPlayer>()
-                     .set<PlayerId>({ id })
-                     .add<Direction>()
-                     .set<Speed>({ speed })
-                     .set<Texture>({ texture })
-                     .set<Position>(position)
-                     .set<Health>({ health })
-                     .set<RectF>({ position.x - tex_w / 2.0f,
-                         position.y - tex_h / 2.0f,
-                         static_cast<float>(tex_w),
-                         static_cast<float>(tex_h) });
-    else
-        player = ecs.entity()
-                     .add<PlayerTag>()
-                     .set<PlayerId>({ id })
-                     .add<Direction>()
-                     .set<Speed>({ speed })
-                     .set<Texture>({ texture })
-                     .set<Position>(position)
-                     .set<Health>({ health })
-                     .set<RectF>({ position.x - tex_w / 2.0f,
-                         position.y - tex_h / 2.0f,
-                         static_cast<float>(tex_w),
-                         static_cast<float>(tex_h) });
+// Entities spawn with the placeholder at their default size and take the
+// real texture and its size once the loader has it, which is immediately
+// when it is already cached.
+void set_texture_when_ready(flecs::entity e, const char* texture_file_name)
+{
+    m_loader.request_texture(texture_file_name, [e](SDL_Texture* texture, int width, int height) {
+        if (!e.is_alive())
+            return;
+
+        const Position& p = e.get<Position>();
+        float           w = static_cast<float>(width);
+        float           h = static_cast<float>(height);
+        e.set<Texture>({ texture });
+        e.set<RectF>({ p.x - w / 2.0f, p.y - h / 2.0f, w, h });
+        m_grid.reserve_extent(w / 2.0f, h / 2.0f);
+    });
+}
 
-    return player;
+// The ground when there is no world to stream.
+void draw_grid_lines(const Camera& cam, float scaleX, float scaleY)
+{
+    float camLeft   = cam.x;
+    float camRight  = cam.x + cam.w;
+    float camTop    = cam.y;
+    float camBottom = cam.y + cam.h;
+
+    int startX = (int)std::floor(camLeft / GRID_SIZE);
+    int endX   = (int)std::ceil(camRight / GRID_SIZE);
+
+    int startY = (int)std::floor(camTop / GRID_SIZE);
+    int endY   = (int)std::ceil(camBottom / GRID_SIZE);
+
+    SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 100);
+    for (int x = startX; x <= endX; ++x) {
+        float worldX = x * GRID_SIZE;
+
+        float screenX = (worldX - cam.x) * scaleX;
+
+        SDL_RenderLine(
+            m_renderer,
+            (int)screenX, 0,
+            (int)screenX, m_window_h);
+    }
+
+    for (int y = startY; y <= endY; ++y) {
+        float worldY = y * GRID_SIZE;
+
+        float screenY = (worldY - cam.y) * scaleY;
+
+        SDL_RenderLine(
+            m_renderer,
+            0, (int)screenY,
+            m_window_w, (int)screenY);
+    }
 }
 
 bool is_in_camera_view(const Camera& cam, const Position objPosition, const float objWidth, const float objHeight)
 {
-    // SDL_Log("Camera X, Y: %f, %f ", cam.x, cam.y);
-    // SDL_Log("Object X, Y: %f, %f ", obj.position.x, obj.position.y);
+    // objPosition is the center of the object, the camera rect is top-left based.
+    const float half_w = objWidth * 0.5f;
+    const float half_h = objHeight * 0.5f;
     return !(
-        objPosition.x + objWidth < cam.x - cam.w || // object is left of camera
-        objPosition.x - objWidth > cam.x + cam.w || // object is right of camera
-        objPosition.y + objHeight < cam.y - cam.w || // object is above camera
-        objPosition.y - objHeight > cam.y + cam.h // object is below camera
+        objPosition.x + half_w < cam.x || // object is left of camera
+        objPosition.x - half_w > cam.x + cam.w || // object is right of camera
+        objPosition.y + half_h < cam.y || // object is above camera
+        objPosition.y - half_h > cam.y + cam.h // object is below camera
     );
 }
 
@@ -586,6 +676,8 @@ void render_font(const char* message, float rect_x, float rect_y)
 {
     SDL_Color    white = { 255, 255, 255, 255 };
     SDL_Texture* tex   = get_font_texture(m_renderer, message, white);
+    if (!tex)
+        return;
 
     SDL_FRect dst = { rect_x, rect_y, 0, 0 };
     SDL_GetTextureSize(tex, &dst.w, &dst.h);
@@ -594,36 +686,6 @@ void render_font(const char* message, float rect_x, float rect_y)
     SDL_DestroyTexture(tex);
 }
 
-void createTexture(SDL_Texture** texture, int& width, int& height, const char* textureFileName)
-{
-    char* player_texture_path {};
-    SDL_asprintf(&player_texture_path, "%s../textures/%s", SDL_GetBasePath(), textureFileName);
-
-    int            channels;
-    unsigned char* data = stbi_load(player_texture_path, &width, &height, &channels, 4);
-    if (!data) {
-        std::cout << "Image path: " << player_texture_path << "\n";
-        std::cout << "Channels: " << channels << "\n";
-        std::cerr << "Failed to load image: " << stbi_failure_reason() << "\n";
-        SDL_LogDebug(1, "%s", "STBI couldnt load the image!");
-    }
-
-    SDL_Surface* surface = SDL_CreateSurfaceFrom(width, height, SDL_PIXELFORMAT_ABGR8888, data, width * 4);
-    if (!surface) {
-        get_error();
-    }
-
-    *texture = SDL_CreateTextureFromSurface(m_renderer, surface);
-    if (!*texture) {
-        get_error();
-        std::cout << player_texture_path << "\n";
-    }
-    SDL_free(player_texture_path);
-
-    SDL_DestroySurface(surface);
-    stbi_image_free(data);
-}
-
 bool isPressedDown {};
 bool isPressedRight {};
 void poll_keyboard_state(flecs::entity player)
@@ -663,6 +725,16 @@ void poll_keyboard_state(flecs::entity player)
         dir.x = 0.0f;
 
     dir = normalize_vector(dir);
+
+    // The player's middle stays out of solid tiles; one axis at a time, so
+    // walking into a wall at an angle slides along it.
+    const Position& p = player.get<Position>();
+    if (dir.x && m_world.solid_at(p.x + dir.x * TILE_SIZE * 0.5f, p.y))
+        dir.x = 0.0f;
+    if (dir.y && m_world.solid_at(p.x, p.y + dir.y * TILE_SIZE * 0.5f))
+        dir.y = 0.0f;
+    dir = normalize_vector(dir);
+
     player.assign<Direction>({ dir });
 
     dir.x *= player.get<Speed>().speed;
@@ -678,62 +750,45 @@ template <typename T>
 void send_data(T data, const int k_n_flag)
 {
     if (m_game_client.m_is_connected) {
-        MsgHeader header;
-        header.type = MsgTraits<T>::type;
-        header.size = sizeof(T);
-
-        uint8_t buffer[sizeof(MsgHeader) + sizeof(T)];
-        memcpy(buffer, &header, sizeof(header));
-        memcpy(buffer + sizeof(header), &data, sizeof(data));
-
-        m_game_client.send_data(
-            &buffer,
-            sizeof(buffer),
-            k_n_flag);
+        uint8_t buffer[encoded_message_size<T>()];
+        size_t  size = encode_message(data, buffer, sizeof(buffer));
+
+        m_game_client.queue_data(buffer, size, k_n_flag);
     }
 }
 
 void send_direction_and_position_data_to_server(Direction dir, Position pos)
 {
     if ((dir.x || dir.y) && m_game_client.m_is_connected) {
-        MsgHeader header;
-        header.type = MsgType::Direction;
-        header.size = sizeof(Direction);
-
-        uint8_t buffer[sizeof(MsgHeader) + sizeof(Direction)];
-        memcpy(buffer, &header, sizeof(header));
-        memcpy(buffer + sizeof(header), &dir, sizeof(dir));
-
-        m_game_client.send_data(&buffer, sizeof(buffer),
-            k_nSteamNetworkingSend_Unreliable);
-
-        MsgHeader pos_header;
-        pos_header.type = MsgType::Position;
-        pos_header.size = sizeof(Position);
-
-        uint8_t pos_buffer[sizeof(MsgHeader) + sizeof(Position)];
-        memcpy(pos_buffer, &pos_header, sizeof(pos_header));
-        memcpy(pos_buffer + sizeof(pos_header), &pos, sizeof(pos));
-
-        m_game_client.send_data(&pos_buffer, sizeof(pos_buffer),
-            k_nSteamNetworkingSend_Unreliable);
+        send_data(dir, k_nSteamNetworkingSend_Unreliable);
+        send_data(pos, k_nSteamNetworkingSend_Unreliable);
     }
 }
 
-template <typename T>
-float get_vector_length(T vec)
+// Connect, then join, then carry on with the id the server gave us, in
+// that order. The frame loop keeps running; GameClient::poll() resumes
+// this as each step completes.
+NetTask join_game(flecs::entity player)
 {
-    return std::sqrt((vec.x * vec.x) + (vec.y * vec.y));
-}
+    m_joining    = true;
+    Uint64 start = SDL_GetPerformanceCounter();
 
-template <typename T>
-T normalize_vector(T vec)
-{
-    float length = get_vector_length(vec);
-    // SDL_LogDebug(1, "LENGTH: %f", length);
-    // // SDL_LogDebug(1, "Vec X: %f", vec.x);
-    // // SDL_LogDebug(1, "Vec Y: %f", vec.y);
-    return (length != 0.0f) ? T { vec.x / length, vec.y / length } : T { 0.0f, 0.0f };
+    if (!co_await m_game_client.connect_async()) {
+        std::cout << "Could not connect to the server.\n";
+        m_joining = false;
+        co_return;
+    }
+
+    auto assigned = co_await m_game_client.join(player.get<PlayerId>().playerId, player.get<Position>());
+    m_joining     = false;
+    if (!assigned) {
+        std::cout << "Connection lost before the server took us in.\n";
+        co_return;
+    }
+
+    // on_player_id_assigned has already moved the local player to its id.
+    double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    std::cout << "Joined as player " << assigned->id << " in " << ms << " ms.\n";
 }
 
 void disconnect_from_server(flecs::entity player)
@@ -743,13 +798,16 @@ void disconnect_from_server(flecs::entity player)
     send_data(msg, k_nSteamNetworkingSend_Reliable);
 
     m_game_client.disconnect_from_server();
+    clear_remote_players();
+}
 
-    for (const auto& [count, entity] : m_players_by_id) {
+void clear_remote_players()
+{
+    m_players_by_id.for_each([](uint32_t id, flecs::entity entity) {
         if (!entity.has<LocalPlayer>()) {
-            SDL_DestroyTexture(entity.get<Texture>().texture);
             entity.destruct();
         }
-    }
+    });
     m_players_by_id.clear();
 }
 
@@ -789,6 +847,7 @@ void sdl_init()
 
     SDL_SetRenderVSync(m_renderer, 0);
 
+    m_loader.init(m_renderer, &m_assets, 2);
     load_font();
 }
 
@@ -796,6 +855,9 @@ SDL_Texture* get_font_texture(SDL_Renderer* renderer,
     const char*                             message,
     SDL_Color                               color)
 {
+    if (!m_font)
+        return nullptr;
+
     SDL_Surface* surf = TTF_RenderText_Blended(m_font, message, 0, color);
     if (!surf)
         return nullptr;
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "net_schema.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Several encoded messages sent as one GameNetworkingSockets message. On the
+// wire a batch is a MsgHeader of type Batch whose payload is the records back
+// to back, each a complete message with its own header. Batches don't nest.
+//
+// Sized to stay inside one UDP datagram at the library's default MTU, so an
+// unreliable batch is lost or delivered as a whole, same as its records
+// would have been.
+constexpr size_t BATCH_MAX_BYTES = 1100;
+
+class MessageBatch {
+public:
+    // False if the record doesn't fit in what is left; flush and retry.
+    // Records bigger than BATCH_MAX_BYTES - MSG_HEADER_SIZE never fit.
+    bool append(const uint8_t* message, size_t size)
+    {
+        if (m_size + size > BATCH_MAX_BYTES)
+            return false;
+        memcpy(m_data + m_size, message, size);
+        m_size += size;
+        ++m_records;
+        return true;
+    }
+
+    template <typename T>
+    bool append(const T& msg)
+    {
+        if (m_size + encoded_message_size<T>() > BATCH_MAX_BYTES)
+            return false;
+        m_size += encode_message(msg, m_data + m_size, BATCH_MAX_BYTES - m_size);
+        ++m_records;
+        return true;
+    }
+
+    bool     empty() const { return m_records == 0; }
+    uint32_t records() const { return m_records; }
+
+    // The bytes to send. A single record goes out bare, without the batch
+    // header around it.
+    const uint8_t* finish(size_t& size)
+    {
+        if (m_records == 1) {
+            size = m_size - MSG_HEADER_SIZE;
+            return m_data + MSG_HEADER_SIZE;
+        }
+
+        NetWriter w(m_data, MSG_HEADER_SIZE);
+        net_schema::write(w, MsgHeader { MsgType::Batch, static_cast<uint16_t>(m_size - MSG_HEADER_SIZE) });
+        size = m_size;
+        return m_data;
+    }
+
+    void clear()
+    {
+        m_size    = MSG_HEADER_SIZE;
+        m_records = 0;
+    }
+
+private:
+    uint8_t  m_data[BATCH_MAX_BYTES];
+    size_t   m_size { MSG_HEADER_SIZE };
+    uint32_t m_records {};
+};
+
+// Calls fn(header, payload) for each record of a batch payload. Stops and
+// returns false on a truncated record, a nested batch, or when fn returns
+// false.
+template <typename Fn>
+bool for_each_batch_record(const uint8_t* payload, size_t size, Fn&& fn)
+{
+    while (size > 0) {
+        MsgHeader header;
+        if (!decode_header(payload, size, header) || header.type == MsgType::Batch)
+            return false;
+
+        if (!fn(header, payload + MSG_HEADER_SIZE))
+            return false;
+
+        size_t record = MSG_HEADER_SIZE + header.size;
+        payload += record;
+        size -= record;
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+#include "net_conditions.h"
+
+#include <cctype>
+#include <cstdio>
+#include <steam/isteamnetworkingutils.h>
+#include <steam/steamnetworkingtypes.h>
+
+namespace {
+
+constexpr NetConditions PROFILES[] = {
+    // name                lag  loss  jitter  jitter%  dup
+    { "perfect", 0, 0.0f, 0, 0.0f, 0.0f },
+    { "lan", 1, 0.0f, 1, 5.0f, 0.0f },
+    { "broadband", 20, 0.1f, 5, 10.0f, 0.0f },
+    { "cross-continent", 90, 0.5f, 15, 10.0f, 0.1f },
+    { "mobile-3pct-loss", 60, 3.0f, 40, 20.0f, 0.5f },
+};
+
+bool equals_ignore_case(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i]))
+            return false;
+    }
+    return true;
+}
+
+}
+
+std::span<const NetConditions> net_conditions_profiles()
+{
+    return PROFILES;
+}
+
+const NetConditions* find_net_conditions(std::string_view name)
+{
+    for (const NetConditions& profile : PROFILES) {
+        if (equals_ignore_case(profile.name, name))
+            return &profile;
+    }
+    return nullptr;
+}
+
+void apply_net_conditions(const NetConditions& c)
+{
+    ISteamNetworkingUtils* utils = SteamNetworkingUtils();
+
+    utils->SetGlobalConfigValueInt32(k_ESteamNetworkingConfig_FakePacketLag_Send, c.lag_ms);
+    utils->SetGlobalConfigValueInt32(k_ESteamNetworkingConfig_FakePacketLag_Recv, c.lag_ms);
+    utils->SetGlobalConfigValueFloat(k_ESteamNetworkingConfig_FakePacketLoss_Send, c.loss_pct);
+    utils->SetGlobalConfigValueFloat(k_ESteamNetworkingConfig_FakePacketLoss_Recv, c.loss_pct);
+
+    // GNS models jitter as a share of packets held back for a fixed time,
+    // which also reorders them relative to their neighbours.
+    utils->SetGlobalConfigValueFloat(k_ESteamNetworkingConfig_FakePacketReorder_Send, c.jitter_pct);
+    utils->SetGlobalConfigValueFloat(k_ESteamNetworkingConfig_FakePacketReorder_Recv, c.jitter_pct);
+    utils->SetGlobalConfigValueInt32(k_ESteamNetworkingConfig_FakePacketReorder_Time, c.jitter_ms);
+
+    utils->SetGlobalConfigValueFloat(k_ESteamNetworkingConfig_FakePacketDup_Send, c.dup_pct);
+    utils->SetGlobalConfigValueFloat(k_ESteamNetworkingConfig_FakePacketDup_Recv, c.dup_pct);
+    utils->SetGlobalConfigValueInt32(k_ESteamNetworkingConfig_FakePacketDup_TimeMax, c.jitter_ms);
+
+    printf("Network conditions '%s': lag %d ms, loss %.1f%%, jitter %d ms on %.0f%%, dup %.1f%%\n",
+        c.name, c.lag_ms, c.loss_pct, c.jitter_ms, c.jitter_pct, c.dup_pct);
+}
+
+void print_net_conditions_profiles()
+{
+    printf("Network condition profiles:\n");
+    for (const NetConditions& c : PROFILES) {
+        printf("  %-18s lag %3d ms  loss %4.1f%%  jitter %3d ms on %4.1f%%  dup %3.1f%%\n",
+            c.name, c.lag_ms, c.loss_pct, c.jitter_ms, c.jitter_pct, c.dup_pct);
+    }
+}
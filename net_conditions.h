@@ -0,0 +1,23 @@
+#pragma once
+
+#include <span>
+#include <string_view>
+
+// A named set of GameNetworkingSockets fake-network settings. Values apply
+// to each direction of every connection in the process, so a profile should
+// be applied on one side of a link only (usually the client or the bench).
+struct NetConditions {
+    const char* name;
+    int         lag_ms; // added one-way delay
+    float       loss_pct;
+    int         jitter_ms; // extra delay for the jittered share of packets
+    float       jitter_pct;
+    float       dup_pct;
+};
+
+std::span<const NetConditions> net_conditions_profiles();
+const NetConditions*           find_net_conditions(std::string_view name);
+
+// Must be called after GameNetworkingSockets_Init.
+void apply_net_conditions(const NetConditions& conditions);
+void print_net_conditions_profiles();
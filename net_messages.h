@@ -1,6 +1,4 @@
 #pragma once
-#include <SDL3/SDL_rect.h>
-#include <SDL3/SDL_render.h>
 #include <cstdint>
 
 template <typename T>
@@ -15,11 +13,22 @@ enum class MsgType : uint8_t {
     MsgPlayerLeft            = 6,
     MsgPlayerIdAssign        = 7,
     MsgPlayerPositionChanged = 8,
-    MsgInitialState          = 9,
+    MsgInitialState          = 9, // variable length, see roster.h
     MsgSpawnBullet           = 10,
+    MsgHello                 = 11,
+    Batch                    = 12, // records back to back, see message_batch.h
+    MsgJoinRoom              = 13,
     // Add more types here
 };
 
+// Records clients send unreliably: a later one supersedes or makes up for
+// a lost one, so rate limits may drop them. A client over a limit on
+// anything else is flooding, and is disconnected instead.
+inline bool is_droppable(MsgType type)
+{
+    return type == MsgType::Position || type == MsgType::Direction || type == MsgType::MsgSpawnBullet;
+}
+
 #pragma pack(push, 1)
 struct MsgHeader {
     MsgType  type;
@@ -82,15 +91,19 @@ struct Range {
 };
 #pragma pack(pop)
 
+// Same layout as SDL_FRect, kept here so the simulation builds without SDL.
 #pragma pack(push, 1)
-struct Texture {
-    SDL_Texture* texture {};
+struct FRect {
+    float x {};
+    float y {};
+    float w {};
+    float h {};
 };
 #pragma pack(pop)
 
 #pragma pack(push, 1)
 struct RectF {
-    SDL_FRect rect {};
+    FRect rect {};
 };
 #pragma pack(pop)
 
@@ -117,10 +130,27 @@ struct Client {
 };
 #pragma pack(pop)
 
+// First message on every connection; the server drops clients whose
+// protocol hash differs from its own (see net_schema.h).
+#pragma pack(push, 1)
+struct MsgHello {
+    uint32_t protocol;
+};
+#pragma pack(pop)
+
+// Sent straight after MsgHello, unbatched. Without it the server puts the
+// client in room 0.
+#pragma pack(push, 1)
+struct MsgJoinRoom {
+    uint32_t room;
+};
+#pragma pack(pop)
+
 #pragma pack(push, 1)
 struct MsgPlayerJoined {
-    uint32_t id;
+    uint32_t id;    // 0 for a new player, else the id to reclaim
     Position position;
+    uint64_t token; // from MsgPlayerIdAssign when reclaiming; never relayed
 };
 #pragma pack(pop)
 
@@ -133,6 +163,7 @@ struct MsgPlayerLeft {
 #pragma pack(push, 1)
 struct MsgPlayerIdAssign {
     uint32_t id;
+    uint64_t token; // proves the id is ours when rejoining after a restart
 };
 #pragma pack(pop)
 
@@ -143,13 +174,6 @@ struct MsgPlayerPositionChanged {
 };
 #pragma pack(pop)
 
-#pragma pack(push, 1)
-struct MsgInitialState {
-    uint32_t count;
-    Client   clients[8];
-};
-#pragma pack(pop)
-
 #pragma pack(push, 1)
 struct MsgSpawnBullet {
     Position pos;
@@ -197,11 +221,16 @@ struct MsgTraits<MsgPlayerIdAssign> {
 };
 
 template <>
-struct MsgTraits<MsgInitialState> {
-    static constexpr MsgType type = MsgType::MsgInitialState;
+struct MsgTraits<MsgSpawnBullet> {
+    static constexpr MsgType type = MsgType::MsgSpawnBullet;
+};
+
+template <>
+struct MsgTraits<MsgHello> {
+    static constexpr MsgType type = MsgType::MsgHello;
 };
 
 template <>
-struct MsgTraits<MsgSpawnBullet> {
-    static constexpr MsgType type = MsgType::MsgSpawnBullet;
+struct MsgTraits<MsgJoinRoom> {
+    static constexpr MsgType type = MsgType::MsgJoinRoom;
 };
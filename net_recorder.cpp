@@ -0,0 +1,135 @@
+#include "net_recorder.h"
+#include "net_schema.h"
+
+#include <cstring>
+
+NetRecorder::~NetRecorder()
+{
+    close();
+}
+
+bool NetRecorder::open(const char* path)
+{
+    close();
+
+    m_file = fopen(path, "wb");
+    if (!m_file)
+        return false;
+
+    RecordingFileHeader header {};
+    memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+    header.version  = RECORDING_VERSION;
+    header.protocol = PROTOCOL_HASH;
+    fwrite(&header, sizeof(header), 1, m_file);
+
+    m_start = std::chrono::steady_clock::now();
+    m_pending.reserve(FLUSH_THRESHOLD * 2);
+    m_writer = std::jthread([this](std::stop_token stop) { writer_loop(stop); });
+    return true;
+}
+
+void NetRecorder::close()
+{
+    if (!m_file)
+        return;
+
+    m_writer.request_stop();
+    m_cv.notify_one();
+    if (m_writer.joinable())
+        m_writer.join();
+
+    // The writer has exited, whatever is left is ours.
+    if (!m_pending.empty()) {
+        fwrite(m_pending.data(), 1, m_pending.size(), m_file);
+        m_pending.clear();
+    }
+
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+void NetRecorder::record(RecordKind kind, HSteamNetConnection conn, const void* data, uint32 size)
+{
+    if (!m_file)
+        return;
+
+    RecordHeader header;
+    header.time_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - m_start)
+                                               .count());
+    header.conn = conn;
+    header.kind = kind;
+    header.size = size;
+
+    bool wake_writer;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        size_t offset = m_pending.size();
+        m_pending.resize(offset + sizeof(header) + size);
+        memcpy(m_pending.data() + offset, &header, sizeof(header));
+        if (size)
+            memcpy(m_pending.data() + offset + sizeof(header), data, size);
+
+        wake_writer = m_pending.size() >= FLUSH_THRESHOLD;
+    }
+
+    if (wake_writer)
+        m_cv.notify_one();
+}
+
+void NetRecorder::writer_loop(std::stop_token stop)
+{
+    std::vector<uint8_t> writing;
+    writing.reserve(FLUSH_THRESHOLD * 2);
+
+    while (!stop.stop_requested()) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait_for(lock, stop, std::chrono::milliseconds(100), [this] {
+                return m_pending.size() >= FLUSH_THRESHOLD;
+            });
+            if (stop.stop_requested())
+                break;
+            m_pending.swap(writing);
+        }
+
+        if (!writing.empty()) {
+            fwrite(writing.data(), 1, writing.size(), m_file);
+            writing.clear();
+        }
+    }
+}
+
+NetRecordingReader::~NetRecordingReader()
+{
+    if (m_file)
+        fclose(m_file);
+}
+
+bool NetRecordingReader::open(const char* path)
+{
+    m_file = fopen(path, "rb");
+    if (!m_file)
+        return false;
+
+    RecordingFileHeader header;
+    if (fread(&header, sizeof(header), 1, m_file) != 1
+        || memcmp(header.magic, RECORDING_MAGIC, sizeof(header.magic)) != 0
+        || header.version != RECORDING_VERSION
+        || header.protocol != PROTOCOL_HASH) {
+        fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool NetRecordingReader::next(RecordHeader& header, std::vector<uint8_t>& data)
+{
+    if (!m_file || fread(&header, sizeof(header), 1, m_file) != 1)
+        return false;
+
+    data.resize(header.size);
+    return header.size == 0 || fread(data.data(), 1, header.size, m_file) == header.size;
+}
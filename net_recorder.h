@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <steam/steamnetworkingtypes.h>
+#include <thread>
+#include <vector>
+
+// Recordings are a file header followed by records. Each record is a
+// RecordHeader and `size` bytes of the message exactly as it was on the
+// wire, so it starts with the MsgHeader. The header carries the
+// PROTOCOL_HASH of the build that recorded it; those bytes only mean
+// something to a build with the same one.
+
+enum class RecordKind : uint8_t {
+    Received     = 0,
+    Sent         = 1,
+    Connected    = 2,
+    Disconnected = 3,
+};
+
+constexpr char     RECORDING_MAGIC[4] = { 'C', 'P', 'R', 'C' };
+constexpr uint16_t RECORDING_VERSION  = 2;
+
+#pragma pack(push, 1)
+struct RecordingFileHeader {
+    char     magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t protocol; // PROTOCOL_HASH
+};
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+struct RecordHeader {
+    uint64_t   time_us; // since the recorder was opened
+    uint32_t   conn;
+    RecordKind kind;
+    uint32_t   size;
+};
+#pragma pack(pop)
+
+// Appends records to an in-memory buffer; a background thread swaps it out
+// and writes it to disk, so the network thread only pays for a memcpy.
+class NetRecorder {
+public:
+    ~NetRecorder();
+
+    bool open(const char* path);
+    void close();
+    bool is_open() const { return m_file != nullptr; }
+
+    void record(RecordKind kind, HSteamNetConnection conn, const void* data = nullptr, uint32 size = 0);
+
+private:
+    static constexpr size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    void writer_loop(std::stop_token stop);
+
+    FILE*                                 m_file {};
+    std::chrono::steady_clock::time_point m_start;
+
+    std::mutex                  m_mutex;
+    std::condition_variable_any m_cv;
+    std::vector<uint8_t>        m_pending;
+    std::jthread                m_writer;
+};
+
+class NetRecordingReader {
+public:
+    ~NetRecordingReader();
+
+    bool open(const char* path);
+    bool next(RecordHeader& header, std::vector<uint8_t>& data);
+
+private:
+    FILE* m_file {};
+};
@@ -0,0 +1,358 @@
+#pragma once
+
+#include "net_messages.h"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Wire encoding for net messages. Each message lists its fields once in a
+// MsgSchema specialization; encode, decode, the encoded size and the
+// protocol hash are all derived from that list. Scalars are little endian,
+// fixed arrays are written element by element and nothing is padded, so on
+// little-endian hosts the bytes match the packed structs.
+//
+// Adding, removing, reordering or retyping a field changes PROTOCOL_HASH,
+// and a client and server built from different schemas refuse each other at
+// connect (see MsgHello).
+
+template <typename T>
+struct MsgSchema;
+
+#define NET_SCHEMA(T, ...)                                       \
+    template <>                                                  \
+    struct MsgSchema<T> {                                        \
+        static constexpr const char* name   = #T;                \
+        static constexpr auto        fields = std::make_tuple(__VA_ARGS__); \
+    }
+
+NET_SCHEMA(MsgHeader, &MsgHeader::type, &MsgHeader::size);
+NET_SCHEMA(Direction, &Direction::x, &Direction::y);
+NET_SCHEMA(Position, &Position::x, &Position::y);
+NET_SCHEMA(Speed, &Speed::speed);
+NET_SCHEMA(Range, &Range::value);
+NET_SCHEMA(Damage, &Damage::value, &Damage::crit_value);
+NET_SCHEMA(Client, &Client::nick, &Client::id, &Client::pos);
+NET_SCHEMA(MsgHello, &MsgHello::protocol);
+NET_SCHEMA(MsgJoinRoom, &MsgJoinRoom::room);
+NET_SCHEMA(MsgPlayerJoined, &MsgPlayerJoined::id, &MsgPlayerJoined::position, &MsgPlayerJoined::token);
+NET_SCHEMA(MsgPlayerLeft, &MsgPlayerLeft::id);
+NET_SCHEMA(MsgPlayerIdAssign, &MsgPlayerIdAssign::id, &MsgPlayerIdAssign::token);
+NET_SCHEMA(MsgPlayerPositionChanged, &MsgPlayerPositionChanged::id, &MsgPlayerPositionChanged::position);
+NET_SCHEMA(MsgSpawnBullet, &MsgSpawnBullet::pos, &MsgSpawnBullet::direction, &MsgSpawnBullet::speed,
+    &MsgSpawnBullet::range, &MsgSpawnBullet::damage);
+
+// Everything that goes through encode_message/decode_payload. The protocol
+// hash covers these in this order.
+using ProtocolMessages = std::tuple<MsgHello, MsgJoinRoom, Direction, Position, MsgPlayerJoined, MsgPlayerLeft,
+    MsgPlayerIdAssign, MsgPlayerPositionChanged, MsgSpawnBullet>;
+
+// Bounds-checked cursor over a caller-owned buffer. A write past the end
+// sets the error flag and is dropped, so callers check ok() once at the end.
+class NetWriter {
+public:
+    NetWriter(uint8_t* data, size_t capacity)
+        : m_data(data)
+        , m_capacity(capacity)
+    {
+    }
+
+    template <typename T>
+    void scalar(T value)
+    {
+        uint8_t bytes[sizeof(T)];
+        memcpy(bytes, &value, sizeof(T));
+        if constexpr (std::endian::native == std::endian::big) {
+            for (size_t i = 0; i < sizeof(T) / 2; ++i) {
+                std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+            }
+        }
+        raw(bytes, sizeof(T));
+    }
+
+    void raw(const void* src, size_t size)
+    {
+        if (m_size + size > m_capacity) {
+            m_ok = false;
+            return;
+        }
+        memcpy(m_data + m_size, src, size);
+        m_size += size;
+    }
+
+    size_t size() const { return m_size; }
+    bool   ok() const { return m_ok; }
+
+private:
+    uint8_t* m_data;
+    size_t   m_capacity;
+    size_t   m_size {};
+    bool     m_ok { true };
+};
+
+class NetReader {
+public:
+    NetReader(const uint8_t* data, size_t size)
+        : m_data(data)
+        , m_size(size)
+    {
+    }
+
+    template <typename T>
+    T scalar()
+    {
+        uint8_t bytes[sizeof(T)] {};
+        raw(bytes, sizeof(T));
+        if constexpr (std::endian::native == std::endian::big) {
+            for (size_t i = 0; i < sizeof(T) / 2; ++i) {
+                std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+            }
+        }
+        T value;
+        memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    void raw(void* dst, size_t size)
+    {
+        if (m_pos + size > m_size) {
+            m_ok = false;
+            return;
+        }
+        memcpy(dst, m_data + m_pos, size);
+        m_pos += size;
+    }
+
+    size_t remaining() const { return m_size - m_pos; }
+    bool   ok() const { return m_ok; }
+
+private:
+    const uint8_t* m_data;
+    size_t         m_size;
+    size_t         m_pos {};
+    bool           m_ok { true };
+};
+
+namespace net_schema {
+
+template <typename T>
+concept Scalar = std::is_arithmetic_v<T> || std::is_enum_v<T>;
+
+template <typename P>
+struct member_of;
+
+template <typename C, typename M>
+struct member_of<M C::*> {
+    using type = M;
+};
+
+template <typename P>
+using member_t = typename member_of<std::remove_cvref_t<P>>::type;
+
+template <typename T, typename M>
+void write_field(NetWriter& w, const T& value, M T::*field);
+template <typename T, typename M>
+void read_field(NetReader& r, T& value, M T::*field);
+
+// Members of packed structs can be misaligned, so scalars are copied in and
+// out by value rather than bound to references.
+template <typename T>
+void write(NetWriter& w, const T& value)
+{
+    if constexpr (Scalar<T>) {
+        w.scalar(value);
+    } else if constexpr (std::is_array_v<T>) {
+        if constexpr (sizeof(std::remove_extent_t<T>) == 1) {
+            w.raw(value, sizeof(T));
+        } else {
+            for (const auto& element : value) {
+                write(w, element);
+            }
+        }
+    } else {
+        std::apply([&](auto... fields) {
+            (write_field(w, value, fields), ...);
+        },
+            MsgSchema<T>::fields);
+    }
+}
+
+template <typename T, typename M>
+void write_field(NetWriter& w, const T& value, M T::*field)
+{
+    if constexpr (Scalar<M>) {
+        M copy;
+        memcpy(&copy, &(value.*field), sizeof(M));
+        w.scalar(copy);
+    } else {
+        write(w, value.*field);
+    }
+}
+
+template <typename T>
+void read(NetReader& r, T& value)
+{
+    if constexpr (Scalar<T>) {
+        value = r.scalar<T>();
+    } else if constexpr (std::is_array_v<T>) {
+        if constexpr (sizeof(std::remove_extent_t<T>) == 1) {
+            r.raw(value, sizeof(T));
+        } else {
+            for (auto& element : value) {
+                read(r, element);
+            }
+        }
+    } else {
+        std::apply([&](auto... fields) {
+            (read_field(r, value, fields), ...);
+        },
+            MsgSchema<T>::fields);
+    }
+}
+
+template <typename T, typename M>
+void read_field(NetReader& r, T& value, M T::*field)
+{
+    if constexpr (Scalar<M>) {
+        M copy = r.scalar<M>();
+        memcpy(&(value.*field), &copy, sizeof(M));
+    } else {
+        read(r, value.*field);
+    }
+}
+
+template <typename T>
+constexpr size_t encoded_size()
+{
+    if constexpr (Scalar<T>) {
+        return sizeof(T);
+    } else if constexpr (std::is_array_v<T>) {
+        return std::extent_v<T> * encoded_size<std::remove_extent_t<T>>();
+    } else {
+        return std::apply([](auto... fields) {
+            return (size_t { 0 } + ... + encoded_size<member_t<decltype(fields)>>());
+        },
+            MsgSchema<T>::fields);
+    }
+}
+
+// FNV-1a over a description of the type: scalar kinds and widths, array
+// extents, struct names and their fields in order.
+constexpr uint32_t FNV_OFFSET = 2166136261u;
+constexpr uint32_t FNV_PRIME  = 16777619u;
+
+constexpr uint32_t hash_byte(uint32_t h, uint8_t b)
+{
+    return (h ^ b) * FNV_PRIME;
+}
+
+constexpr uint32_t hash_u32(uint32_t h, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i) {
+        h = hash_byte(h, static_cast<uint8_t>(v >> (i * 8)));
+    }
+    return h;
+}
+
+constexpr uint32_t hash_str(uint32_t h, const char* s)
+{
+    for (; *s; ++s) {
+        h = hash_byte(h, static_cast<uint8_t>(*s));
+    }
+    return hash_byte(h, 0);
+}
+
+template <typename T>
+constexpr uint32_t hash_type(uint32_t h)
+{
+    if constexpr (std::is_enum_v<T>) {
+        return hash_u32(hash_byte(h, 'e'), sizeof(T));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        return hash_u32(hash_byte(h, 'f'), sizeof(T));
+    } else if constexpr (std::is_integral_v<T>) {
+        return hash_u32(hash_byte(h, std::is_signed_v<T> ? 'i' : 'u'), sizeof(T));
+    } else if constexpr (std::is_array_v<T>) {
+        return hash_type<std::remove_extent_t<T>>(hash_u32(hash_byte(h, '['), std::extent_v<T>));
+    } else {
+        h = hash_str(hash_byte(h, '{'), MsgSchema<T>::name);
+        h = std::apply([h](auto... fields) {
+            uint32_t acc = h;
+            ((acc = hash_type<member_t<decltype(fields)>>(acc)), ...);
+            return acc;
+        },
+            MsgSchema<T>::fields);
+        return hash_byte(h, '}');
+    }
+}
+
+template <typename... Ts>
+constexpr uint32_t hash_protocol(std::tuple<Ts*...>*)
+{
+    uint32_t h = FNV_OFFSET;
+    ((h = hash_type<Ts>(hash_byte(h, static_cast<uint8_t>(MsgTraits<Ts>::type)))), ...);
+    return hash_type<MsgHeader>(h);
+}
+
+template <typename Tuple>
+struct pointer_tuple;
+
+template <typename... Ts>
+struct pointer_tuple<std::tuple<Ts...>> {
+    using type = std::tuple<Ts*...>;
+};
+
+}
+
+// Bumped for wire changes the schemas can't see, like framing.
+// 1: MsgType::Batch
+// 2: MsgInitialState is a variable-length roster
+constexpr uint32_t PROTOCOL_REVISION = 2;
+
+// Client is covered separately, as the roster entry (see roster.h).
+constexpr uint32_t PROTOCOL_HASH = net_schema::hash_u32(
+    net_schema::hash_type<Client>(net_schema::hash_protocol(
+        static_cast<typename net_schema::pointer_tuple<ProtocolMessages>::type*>(nullptr))),
+    PROTOCOL_REVISION);
+
+constexpr size_t MSG_HEADER_SIZE = net_schema::encoded_size<MsgHeader>();
+
+template <typename T>
+constexpr size_t encoded_message_size()
+{
+    return MSG_HEADER_SIZE + net_schema::encoded_size<T>();
+}
+
+// Header plus payload. Returns the bytes written, or 0 if `capacity` is too
+// small; an array of encoded_message_size<T>() bytes always fits.
+template <typename T>
+size_t encode_message(const T& msg, uint8_t* out, size_t capacity)
+{
+    NetWriter w(out, capacity);
+    net_schema::write(w, MsgHeader { MsgTraits<T>::type, static_cast<uint16_t>(net_schema::encoded_size<T>()) });
+    net_schema::write(w, msg);
+    return w.ok() ? w.size() : 0;
+}
+
+// Payloads must be exactly the schema size.
+template <typename T>
+bool decode_payload(const uint8_t* payload, size_t size, T& msg)
+{
+    if (size != net_schema::encoded_size<T>())
+        return false;
+
+    NetReader r(payload, size);
+    net_schema::read(r, msg);
+    return r.ok();
+}
+
+// False if `size` can't hold the header or the payload it announces.
+inline bool decode_header(const uint8_t* data, size_t size, MsgHeader& header)
+{
+    NetReader r(data, size);
+    net_schema::read(r, header);
+    return r.ok() && r.remaining() >= header.size;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+
+// Fire-and-forget coroutine for network flows such as connect-then-join.
+// Runs eagerly up to its first co_await on a GameClient awaitable, is
+// resumed from GameClient::poll() on the game thread, and frees itself
+// when it returns. Nothing blocks and no thread is spawned.
+struct NetTask {
+    struct promise_type {
+        NetTask            get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void               return_void() { }
+        void               unhandled_exception() { std::terminate(); }
+    };
+};
@@ -0,0 +1,375 @@
+#include "message_batch.h"
+#include "net_conditions.h"
+#include "net_messages.h"
+#include "net_schema.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <steam/isteamnetworkingsockets.h>
+#include <steam/isteamnetworkingutils.h>
+#include <steam/steamnetworkingsockets.h>
+#include <steam/steamnetworkingtypes.h>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Scripted bots against a running `server`, repeated under each network
+// condition profile. The profile is applied in this process only, so the
+// server should run without --netsim; every bot -> server -> bot path then
+// crosses the emulated link twice, like two real clients would.
+//
+// Usage: netbench [--server ADDR] [--profile NAME|all] [--bots N] [--seconds S]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr float  PATH_RADIUS     = 200.0f;
+constexpr float  PATH_SPACING    = 300.0f;
+constexpr double POSITION_RATE_S = 1.0 / 60.0;
+constexpr double BULLET_RATE_S   = 0.1;
+constexpr double SAMPLE_RATE_S   = 0.05;
+constexpr double WARMUP_S        = 1.0;
+
+struct Bot {
+    HSteamNetConnection conn { k_HSteamNetConnection_Invalid };
+    uint32_t            id {};
+    bool                has_id {};
+
+    std::unordered_map<uint32_t, Position> seen; // last received position per player id
+    std::unordered_set<uint64_t>           bullets; // bullet_key of each spawn, duplicates ignored
+
+    uint64_t bytes_sent {};
+    uint64_t bytes_received {};
+};
+
+struct ProfileResult {
+    double mean_error {};
+    double p95_error {};
+    double bullet_delivery {};
+    double app_up_kib_s {};
+    double app_down_kib_s {};
+    double gns_up_kib_s {};
+    double gns_down_kib_s {};
+    int    ping_ms {};
+};
+
+// Deterministic path, so the bench always knows where a bot really is.
+Position bot_position(size_t index, double t)
+{
+    float angle = static_cast<float>(t) + static_cast<float>(index);
+    return { index * PATH_SPACING + PATH_RADIUS * std::cos(angle), PATH_RADIUS * std::sin(angle) };
+}
+
+template <typename T>
+void send_msg(ISteamNetworkingSockets* sockets, Bot& bot, const T& data, int k_n_flag)
+{
+    uint8_t buffer[encoded_message_size<T>()];
+    size_t  size = encode_message(data, buffer, sizeof(buffer));
+
+    sockets->SendMessageToConnection(bot.conn, buffer, static_cast<uint32>(size), k_n_flag, nullptr);
+    bot.bytes_sent += size;
+}
+
+// Identifies a spawn by what the sender put in it; the server relays the
+// message as is. Every bullet leaves from a new spot on the path, aimed a
+// new way, so two bullets in one run never share a key.
+uint64_t bullet_key(const MsgSpawnBullet& msg)
+{
+    uint32_t bits[4];
+    memcpy(&bits[0], &msg.pos.x, sizeof(float));
+    memcpy(&bits[1], &msg.pos.y, sizeof(float));
+    memcpy(&bits[2], &msg.direction.x, sizeof(float));
+    memcpy(&bits[3], &msg.direction.y, sizeof(float));
+
+    uint64_t key = 14695981039346656037ull;
+    for (uint32_t b : bits) {
+        key = (key ^ b) * 1099511628211ull;
+    }
+    return key;
+}
+
+void handle_record(Bot& bot, const MsgHeader& header, const uint8_t* payload)
+{
+    MsgPlayerIdAssign        id_msg;
+    MsgPlayerPositionChanged position_msg;
+    MsgSpawnBullet           bullet_msg;
+    if (header.type == MsgType::MsgPlayerIdAssign && decode_payload(payload, header.size, id_msg)) {
+        bot.id     = id_msg.id;
+        bot.has_id = true;
+    } else if (header.type == MsgType::MsgPlayerPositionChanged && decode_payload(payload, header.size, position_msg)) {
+        bot.seen[position_msg.id] = position_msg.position;
+    } else if (header.type == MsgType::MsgSpawnBullet && decode_payload(payload, header.size, bullet_msg)) {
+        bot.bullets.insert(bullet_key(bullet_msg));
+    }
+}
+
+void receive(ISteamNetworkingSockets* sockets, Bot& bot)
+{
+    ISteamNetworkingMessage* msgs[64];
+    int                      count;
+    while ((count = sockets->ReceiveMessagesOnConnection(bot.conn, msgs, 64)) > 0) {
+        for (int i = 0; i < count; ++i) {
+            const uint8_t* data = static_cast<const uint8_t*>(msgs[i]->m_pData);
+            uint32_t       size = msgs[i]->m_cbSize;
+            bot.bytes_received += size;
+
+            MsgHeader      header;
+            const uint8_t* payload = data + MSG_HEADER_SIZE;
+            if (!decode_header(data, size, header)) {
+                // malformed, ignore
+            } else if (header.type == MsgType::Batch) {
+                for_each_batch_record(payload, header.size, [&](const MsgHeader& record, const uint8_t* record_payload) {
+                    handle_record(bot, record, record_payload);
+                    return true;
+                });
+            } else {
+                handle_record(bot, header, payload);
+            }
+            msgs[i]->Release();
+        }
+    }
+}
+
+bool connect_bots(ISteamNetworkingSockets* sockets, const SteamNetworkingIPAddr& addr, std::vector<Bot>& bots)
+{
+    for (Bot& bot : bots) {
+        bot      = Bot {};
+        bot.conn = sockets->ConnectByIPAddress(addr, 0, nullptr);
+        if (bot.conn == k_HSteamNetConnection_Invalid)
+            return false;
+    }
+
+    auto deadline = Clock::now() + std::chrono::seconds(10);
+    while (Clock::now() < deadline) {
+        sockets->RunCallbacks();
+
+        size_t connected = 0;
+        for (Bot& bot : bots) {
+            SteamNetConnectionInfo_t info;
+            if (!sockets->GetConnectionInfo(bot.conn, &info))
+                return false;
+            if (info.m_eState == k_ESteamNetworkingConnectionState_ClosedByPeer
+                || info.m_eState == k_ESteamNetworkingConnectionState_ProblemDetectedLocally)
+                return false;
+            connected += info.m_eState == k_ESteamNetworkingConnectionState_Connected;
+        }
+        if (connected == bots.size())
+            return true;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+
+void disconnect_bots(ISteamNetworkingSockets* sockets, std::vector<Bot>& bots)
+{
+    for (Bot& bot : bots) {
+        if (bot.conn != k_HSteamNetConnection_Invalid) {
+            sockets->CloseConnection(bot.conn, 0, "netbench done", false);
+            bot.conn = k_HSteamNetConnection_Invalid;
+        }
+    }
+}
+
+bool run_profile(ISteamNetworkingSockets* sockets, const SteamNetworkingIPAddr& addr, size_t bot_count, double seconds, ProfileResult& result)
+{
+    std::vector<Bot> bots(bot_count);
+    if (!connect_bots(sockets, addr, bots)) {
+        disconnect_bots(sockets, bots);
+        return false;
+    }
+
+    for (size_t i = 0; i < bots.size(); ++i) {
+        send_msg(sockets, bots[i], MsgHello { PROTOCOL_HASH }, k_nSteamNetworkingSend_Reliable);
+        send_msg(sockets, bots[i], MsgPlayerJoined { 0, bot_position(i, 0.0) }, k_nSteamNetworkingSend_Reliable);
+    }
+
+    std::unordered_map<uint32_t, size_t> bot_by_id;
+    std::vector<double>                  errors;
+    std::unordered_set<uint64_t>         bullets_sent; // bullet_key of each spawn sent
+
+    auto   start         = Clock::now();
+    double next_position = 0.0;
+    double next_bullet   = WARMUP_S;
+    double next_sample   = WARMUP_S;
+    double end           = WARMUP_S + seconds;
+
+    for (;;) {
+        double t = std::chrono::duration<double>(Clock::now() - start).count();
+        if (t >= end)
+            break;
+
+        sockets->RunCallbacks();
+        for (Bot& bot : bots) {
+            receive(sockets, bot);
+        }
+
+        if (t >= next_position) {
+            for (size_t i = 0; i < bots.size(); ++i) {
+                send_msg(sockets, bots[i], bot_position(i, t), k_nSteamNetworkingSend_Unreliable);
+            }
+            next_position += POSITION_RATE_S;
+        }
+
+        if (t >= next_bullet && bots.size() > 1) {
+            float          aim = static_cast<float>(bullets_sent.size()) * 2.39996f; // golden angle
+            MsgSpawnBullet msg {};
+            msg.pos       = bot_position(0, t);
+            msg.direction = { std::cos(aim), std::sin(aim) };
+            bullets_sent.insert(bullet_key(msg));
+            send_msg(sockets, bots[0], msg, k_nSteamNetworkingSend_Unreliable);
+            next_bullet += BULLET_RATE_S;
+        }
+
+        if (t >= next_sample) {
+            if (bot_by_id.size() < bots.size()) {
+                for (size_t i = 0; i < bots.size(); ++i) {
+                    if (bots[i].has_id) {
+                        bot_by_id[bots[i].id] = i;
+                    }
+                }
+            }
+
+            // Each bot's view of every other bot against where it really is.
+            for (const Bot& observer : bots) {
+                for (const auto& [id, pos] : observer.seen) {
+                    auto it = bot_by_id.find(id);
+                    if (it == bot_by_id.end())
+                        continue;
+                    Position truth = bot_position(it->second, t);
+                    errors.push_back(std::hypot(truth.x - pos.x, truth.y - pos.y));
+                }
+            }
+            next_sample += SAMPLE_RATE_S;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Let bullets still in flight land before counting them.
+    auto drain = Clock::now() + std::chrono::milliseconds(500);
+    while (Clock::now() < drain) {
+        sockets->RunCallbacks();
+        for (Bot& bot : bots) {
+            receive(sockets, bot);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    for (Bot& bot : bots) {
+        SteamNetConnectionRealTimeStatus_t status;
+        if (sockets->GetConnectionRealTimeStatus(bot.conn, &status, 0, nullptr) == k_EResultOK) {
+            result.gns_up_kib_s += status.m_flOutBytesPerSec / 1024.0 / bots.size();
+            result.gns_down_kib_s += status.m_flInBytesPerSec / 1024.0 / bots.size();
+            result.ping_ms = std::max(result.ping_ms, status.m_nPing);
+        }
+        result.app_up_kib_s += bot.bytes_sent / elapsed / 1024.0 / bots.size();
+        result.app_down_kib_s += bot.bytes_received / elapsed / 1024.0 / bots.size();
+    }
+
+    if (!errors.empty()) {
+        double sum = 0.0;
+        for (double e : errors) {
+            sum += e;
+        }
+        std::sort(errors.begin(), errors.end());
+        result.mean_error = sum / errors.size();
+        result.p95_error  = errors[std::min(errors.size() - 1, errors.size() * 95 / 100)];
+    }
+
+    // Anything received that this run didn't send is stale.
+    uint64_t expected  = static_cast<uint64_t>(bullets_sent.size()) * (bots.size() - 1);
+    uint64_t delivered = 0;
+    for (size_t i = 1; i < bots.size(); ++i) {
+        for (uint64_t key : bots[i].bullets) {
+            delivered += bullets_sent.contains(key);
+        }
+    }
+    result.bullet_delivery = expected ? static_cast<double>(delivered) / expected : 0.0;
+
+    disconnect_bots(sockets, bots);
+    return true;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const char* server_addr = "127.0.0.1:7776";
+    const char* profile     = "all";
+    size_t      bot_count   = 4;
+    double      seconds     = 10.0;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--server")) {
+            server_addr = argv[i + 1];
+        } else if (!strcmp(argv[i], "--profile")) {
+            profile = argv[i + 1];
+        } else if (!strcmp(argv[i], "--bots")) {
+            bot_count = std::max(2, atoi(argv[i + 1]));
+        } else if (!strcmp(argv[i], "--seconds")) {
+            seconds = std::max(1.0, atof(argv[i + 1]));
+        } else {
+            fprintf(stderr, "Usage: netbench [--server ADDR] [--profile NAME|all] [--bots N] [--seconds S]\n");
+            return 1;
+        }
+    }
+
+    std::vector<const NetConditions*> profiles;
+    if (!strcmp(profile, "all")) {
+        for (const NetConditions& c : net_conditions_profiles()) {
+            profiles.push_back(&c);
+        }
+    } else if (const NetConditions* c = find_net_conditions(profile)) {
+        profiles.push_back(c);
+    } else {
+        print_net_conditions_profiles();
+        return 1;
+    }
+
+    SteamNetworkingIPAddr addr;
+    addr.Clear();
+    if (!addr.ParseString(server_addr)) {
+        fprintf(stderr, "Invalid server address '%s'\n", server_addr);
+        return 1;
+    }
+
+    SteamDatagramErrMsg err_msg;
+    if (!GameNetworkingSockets_Init(nullptr, err_msg)) {
+        fprintf(stderr, "GameNetworkingSockets_Init failed! %s\n", err_msg);
+        return 1;
+    }
+    ISteamNetworkingSockets* sockets = SteamNetworkingSockets();
+
+    std::vector<std::pair<const NetConditions*, ProfileResult>> results;
+    for (const NetConditions* conditions : profiles) {
+        apply_net_conditions(*conditions);
+
+        ProfileResult result;
+        if (!run_profile(sockets, addr, bot_count, seconds, result)) {
+            fprintf(stderr, "Couldn't connect %zu bots to %s under '%s'\n", bot_count, server_addr, conditions->name);
+            GameNetworkingSockets_Kill();
+            return 1;
+        }
+        results.emplace_back(conditions, result);
+    }
+
+    GameNetworkingSockets_Kill();
+
+    printf("\n%zu bots, %.0f s per profile against %s\n", bot_count, seconds, server_addr);
+    printf("%-18s %6s %10s %10s %9s %21s %21s\n",
+        "profile", "ping", "err mean", "err p95", "bullets", "app up/down KiB/s", "wire up/down KiB/s");
+    for (const auto& [c, r] : results) {
+        printf("%-18s %4d ms %8.1f px %8.1f px %8.1f%% %10.2f / %8.2f %10.2f / %8.2f\n",
+            c->name, r.ping_ms, r.mean_error, r.p95_error, r.bullet_delivery * 100.0,
+            r.app_up_kib_s, r.app_down_kib_s, r.gns_up_kib_s, r.gns_down_kib_s);
+    }
+    return 0;
+}
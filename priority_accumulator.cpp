@@ -0,0 +1,116 @@
+#include "priority_accumulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+struct ClassParams {
+    float weight;  // priority gained per second right next to the viewer
+    float max_age; // seconds before a pending update is dropped, 0 = never
+};
+
+// A player's position is state and stays relevant until replaced; a bullet
+// spawn is an event that looks wrong if it arrives late.
+constexpr ClassParams CLASS_PARAMS[] = {
+    { 1.0f, 0.0f }, // Player
+    { 0.5f, 0.5f }, // Bullet
+};
+
+// Priority halves at this distance from the viewer, a bit over a screen.
+constexpr float DISTANCE_FALLOFF = 600.0f;
+
+const ClassParams& params(UpdateClass cls)
+{
+    return CLASS_PARAMS[static_cast<size_t>(cls)];
+}
+
+}
+
+void PriorityAccumulator::push(uint64_t key, UpdateClass cls, Position pos, const uint8_t* message, size_t size)
+{
+    if (size > sizeof(Update::message))
+        return;
+
+    auto it = m_index.find(key);
+    if (it == m_index.end()) {
+        it = m_index.emplace(key, m_updates.size()).first;
+        m_updates.push_back({ key, cls, pos, 0.0f, 0.0f, false });
+    }
+
+    Update& update = m_updates[it->second];
+    update.pos     = pos;
+    update.age     = 0.0f;
+    update.size    = static_cast<uint8_t>(size);
+    memcpy(update.message, message, size);
+}
+
+void PriorityAccumulator::erase(uint64_t key)
+{
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        remove_at(it->second);
+    }
+}
+
+void PriorityAccumulator::remove_at(size_t index)
+{
+    m_index.erase(m_updates[index].key);
+    if (index + 1 != m_updates.size()) {
+        m_updates[index]              = m_updates.back();
+        m_index[m_updates[index].key] = index;
+    }
+    m_updates.pop_back();
+}
+
+void PriorityAccumulator::accumulate(Position viewer, float dt, float hold_beyond)
+{
+    for (size_t i = 0; i < m_updates.size();) {
+        Update&            update = m_updates[i];
+        const ClassParams& p      = params(update.cls);
+
+        update.age += dt;
+        if (p.max_age > 0.0f && update.age > p.max_age) {
+            ++m_expired;
+            remove_at(i);
+            continue;
+        }
+
+        float distance = std::hypot(update.pos.x - viewer.x, update.pos.y - viewer.y);
+        update.priority += dt * p.weight / (1.0f + distance / DISTANCE_FALLOFF);
+        update.held = distance > hold_beyond;
+        ++i;
+    }
+}
+
+size_t PriorityAccumulator::fill(MessageBatch& batch, size_t budget)
+{
+    m_order.resize(m_updates.size());
+    for (size_t i = 0; i < m_order.size(); ++i) {
+        m_order[i] = i;
+    }
+    std::sort(m_order.begin(), m_order.end(), [this](size_t a, size_t b) {
+        return m_updates[a].priority > m_updates[b].priority;
+    });
+
+    // Indices shift as sent updates are removed, so remove afterwards.
+    size_t used = 0;
+    size_t sent = 0;
+    for (size_t index : m_order) {
+        const Update& update = m_updates[index];
+        if (update.held)
+            continue;
+        if (used + update.size > budget || !batch.append(update.message, update.size))
+            break;
+        used += update.size;
+        m_order[sent++] = index;
+    }
+
+    m_order.resize(sent);
+    std::sort(m_order.begin(), m_order.end(), std::greater<size_t>());
+    for (size_t index : m_order) {
+        remove_at(index);
+    }
+    return used;
+}
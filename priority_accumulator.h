@@ -0,0 +1,61 @@
+#pragma once
+
+#include "message_batch.h"
+#include "net_messages.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+enum class UpdateClass : uint8_t {
+    Player,
+    Bullet,
+};
+
+// Outbound entity updates waiting for one client. Every tick each pending
+// update gains priority scaled by its class and by how close it is to the
+// client's player; fill() then sends the highest first until the client's
+// byte budget runs out. Sent updates leave the queue (their priority resets),
+// the rest keep accumulating, so far away or low-value entities go out less
+// often instead of piling up in the socket's send queue.
+class PriorityAccumulator {
+public:
+    // Queues the newest state of `key`. A newer update for the same key
+    // replaces the pending one and keeps its accumulated priority.
+    void push(uint64_t key, UpdateClass cls, Position pos, const uint8_t* message, size_t size);
+    void erase(uint64_t key);
+
+    // Ages and reprioritizes everything pending; updates older than their
+    // class allows are dropped and counted. Updates farther than
+    // `hold_beyond` from the viewer still gain priority but sit out the
+    // next fill().
+    void accumulate(Position viewer, float dt, float hold_beyond = INFINITY);
+
+    // Appends updates to `batch`, highest priority first, while they fit in
+    // both the batch and `budget` bytes. Returns the bytes appended.
+    size_t fill(MessageBatch& batch, size_t budget);
+
+    size_t   pending() const { return m_updates.size(); }
+    uint64_t expired() const { return m_expired; }
+
+private:
+    struct Update {
+        uint64_t    key;
+        UpdateClass cls;
+        Position    pos;
+        float       priority;
+        float       age;
+        bool        held;
+        uint8_t     size;
+        uint8_t     message[48];
+    };
+
+    void remove_at(size_t index);
+
+    std::vector<Update>                  m_updates;
+    std::unordered_map<uint64_t, size_t> m_index; // key -> m_updates slot
+    std::vector<size_t>                  m_order; // scratch for fill()
+    uint64_t                             m_expired {};
+};
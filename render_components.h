@@ -0,0 +1,13 @@
+#pragma once
+
+#include <SDL3/SDL_render.h>
+
+// Client-only components that hold renderer resources. Kept out of
+// net_messages.h so the simulation and the server never see SDL.
+
+// Borrowed from the AssetLoader cache, which destroys it.
+#pragma pack(push, 1)
+struct Texture {
+    SDL_Texture* texture {};
+};
+#pragma pack(pop)
@@ -0,0 +1,124 @@
+#include "game_server.h"
+#include "net_recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Feeds a recording made with `server --record` back into a headless
+// GameServer and reports how long the server spent on it and what it sent.
+//
+// Usage: replay FILE [--max-speed]
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: replay FILE [--max-speed]\n");
+        return 1;
+    }
+
+    const char* path      = argv[1];
+    bool        max_speed = argc > 2 && !strcmp(argv[2], "--max-speed");
+
+    NetRecordingReader reader;
+    if (!reader.open(path)) {
+        fprintf(stderr, "Can't read recording '%s' (missing, or recorded by a build with another protocol)\n", path);
+        return 1;
+    }
+
+    GameServer server;
+    server.init_headless();
+
+    // Work is grouped into windows of one client frame so the numbers read
+    // like tick times.
+    constexpr uint64_t  TICK_US = 1'000'000 / 60;
+    std::vector<double> tick_ms;
+    uint64_t            tick_index = 0;
+    double              tick_work  = 0.0;
+
+    uint64_t recorded_sent_msgs  = 0;
+    uint64_t recorded_sent_bytes = 0;
+    uint64_t last_time_us        = 0;
+
+    RecordHeader         header;
+    std::vector<uint8_t> data;
+    auto                 start = std::chrono::steady_clock::now();
+
+    while (reader.next(header, data)) {
+        last_time_us = header.time_us;
+
+        if (header.kind == RecordKind::Sent) {
+            ++recorded_sent_msgs;
+            recorded_sent_bytes += header.size;
+            continue;
+        }
+
+        if (!max_speed) {
+            std::this_thread::sleep_until(start + std::chrono::microseconds(header.time_us));
+        }
+
+        while (header.time_us / TICK_US > tick_index) {
+            auto t0 = std::chrono::steady_clock::now();
+            server.tick(TICK_US * 1e-6f);
+            tick_work += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+            tick_ms.push_back(tick_work);
+            tick_work = 0.0;
+            ++tick_index;
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        switch (header.kind) {
+        case RecordKind::Connected:
+            server.inject_connected(header.conn);
+            break;
+        case RecordKind::Disconnected:
+            server.inject_disconnected(header.conn);
+            break;
+        case RecordKind::Received:
+            server.inject_message(header.conn, data.data(), header.size);
+            break;
+        default:
+            break;
+        }
+        tick_work += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+    server.tick(TICK_US * 1e-6f); // drain what the last window posted
+    tick_ms.push_back(tick_work);
+
+    double wall_s     = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double recorded_s = std::max(last_time_us * 1e-6, 1e-6);
+
+    std::sort(tick_ms.begin(), tick_ms.end());
+    auto percentile = [&](double p) {
+        return tick_ms[std::min(tick_ms.size() - 1, static_cast<size_t>(p * tick_ms.size()))];
+    };
+
+    const ServerStats& stats = server.stats();
+    printf("replay of %s (%.2f s recorded, %.2f s wall, %s)\n",
+        path, recorded_s, wall_s, max_speed ? "max speed" : "real time");
+    printf("  received  %10llu msgs %12llu bytes  (%llu records)\n",
+        (unsigned long long)stats.messages_received, (unsigned long long)stats.bytes_received,
+        (unsigned long long)stats.records_received);
+    printf("  sent      %10llu msgs %12llu bytes  %10.1f KiB/s\n",
+        (unsigned long long)stats.messages_sent, (unsigned long long)stats.bytes_sent,
+        stats.bytes_sent / recorded_s / 1024.0);
+    printf("  updates   %10llu sent %10llu expired %10llu below epsilon\n",
+        (unsigned long long)stats.updates_sent, (unsigned long long)stats.updates_expired,
+        (unsigned long long)stats.positions_suppressed);
+    printf("  load      %10llu mode changes %8llu degraded ticks %8llu cosmetic dropped %8llu chat coalesced\n",
+        (unsigned long long)stats.load_mode_changes, (unsigned long long)stats.degraded_ticks,
+        (unsigned long long)stats.cosmetic_dropped, (unsigned long long)stats.chat_coalesced);
+    printf("  congested %10llu client ticks held %6llu unreliable suppressed\n",
+        (unsigned long long)stats.congested_ticks, (unsigned long long)stats.unreliable_suppressed);
+    printf("  limited   %10llu dropped %9llu coalesced\n",
+        (unsigned long long)stats.rate_limited, (unsigned long long)stats.rate_coalesced);
+    printf("  recorded  %10llu msgs %12llu bytes  %10.1f KiB/s\n",
+        (unsigned long long)recorded_sent_msgs, (unsigned long long)recorded_sent_bytes,
+        recorded_sent_bytes / recorded_s / 1024.0);
+    printf("  tick work p50 %.4f ms  p99 %.4f ms  max %.4f ms  (%zu ticks)\n",
+        percentile(0.50), percentile(0.99), tick_ms.back(), tick_ms.size());
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "roster.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr size_t ROSTER_POSITION_OFFSET = net_schema::encoded_size<char[32]>() + net_schema::encoded_size<uint32_t>();
+static_assert(ROSTER_POSITION_OFFSET + net_schema::encoded_size<Position>() == ROSTER_ENTRY_SIZE,
+    "roster position patching assumes Client is nick, id, pos");
+
+}
+
+Roster::Roster()
+{
+    m_message.resize(MSG_HEADER_SIZE + sizeof(uint16_t));
+    write_counts();
+}
+
+bool Roster::add(HSteamNetConnection conn, const Client& client)
+{
+    remove(conn);
+    if (m_conns.size() >= ROSTER_MAX_ENTRIES)
+        return false;
+
+    size_t offset = m_message.size();
+    m_message.resize(offset + ROSTER_ENTRY_SIZE);
+    NetWriter w(m_message.data() + offset, ROSTER_ENTRY_SIZE);
+    net_schema::write(w, client);
+
+    m_index[conn] = m_conns.size();
+    m_conns.push_back(conn);
+    write_counts();
+    return true;
+}
+
+void Roster::remove(HSteamNetConnection conn)
+{
+    auto it = m_index.find(conn);
+    if (it == m_index.end())
+        return;
+
+    size_t index = it->second;
+    size_t last  = m_conns.size() - 1;
+    if (index != last) {
+        memcpy(entry(index), entry(last), ROSTER_ENTRY_SIZE);
+        m_conns[index]          = m_conns[last];
+        m_index[m_conns[index]] = index;
+    }
+
+    m_index.erase(conn);
+    m_conns.pop_back();
+    m_message.resize(m_message.size() - ROSTER_ENTRY_SIZE);
+    write_counts();
+}
+
+void Roster::set_position(HSteamNetConnection conn, Position pos)
+{
+    auto it = m_index.find(conn);
+    if (it == m_index.end())
+        return;
+
+    NetWriter w(entry(it->second) + ROSTER_POSITION_OFFSET, net_schema::encoded_size<Position>());
+    net_schema::write(w, pos);
+}
+
+void Roster::write_counts()
+{
+    NetWriter w(m_message.data(), MSG_HEADER_SIZE + sizeof(uint16_t));
+    net_schema::write(w, MsgHeader { MsgType::MsgInitialState, static_cast<uint16_t>(m_message.size() - MSG_HEADER_SIZE) });
+    w.scalar(static_cast<uint16_t>(m_conns.size()));
+}
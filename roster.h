@@ -0,0 +1,54 @@
+#pragma once
+
+#include "net_schema.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <steam/steamnetworkingtypes.h>
+#include <unordered_map>
+#include <vector>
+
+// MsgInitialState payload: a u16 count, then that many Clients encoded by
+// their schema.
+constexpr size_t ROSTER_ENTRY_SIZE  = net_schema::encoded_size<Client>();
+constexpr size_t ROSTER_MAX_ENTRIES = (UINT16_MAX - sizeof(uint16_t)) / ROSTER_ENTRY_SIZE;
+
+// A room's players as a ready-to-send MsgInitialState, so a join costs one
+// memcpy into the socket however many players there are. Joins append,
+// leaves move the last entry into the hole, and position changes are
+// written over the entry in place.
+class Roster {
+public:
+    Roster();
+
+    bool add(HSteamNetConnection conn, const Client& client); // false when full
+    void remove(HSteamNetConnection conn);
+    void set_position(HSteamNetConnection conn, Position pos);
+
+    size_t         count() const { return m_conns.size(); }
+    const uint8_t* message() const { return m_message.data(); }
+    size_t         message_size() const { return m_message.size(); }
+
+private:
+    void     write_counts();
+    uint8_t* entry(size_t index) { return m_message.data() + MSG_HEADER_SIZE + sizeof(uint16_t) + index * ROSTER_ENTRY_SIZE; }
+
+    std::vector<uint8_t>                            m_message;
+    std::vector<HSteamNetConnection>                m_conns; // entry order
+    std::unordered_map<HSteamNetConnection, size_t> m_index;
+};
+
+// False if the payload isn't a whole roster.
+inline bool decode_roster(const uint8_t* payload, size_t size, std::vector<Client>& clients)
+{
+    NetReader r(payload, size);
+    uint16_t  count = r.scalar<uint16_t>();
+    if (!r.ok() || r.remaining() != count * ROSTER_ENTRY_SIZE)
+        return false;
+
+    clients.resize(count);
+    for (Client& client : clients) {
+        net_schema::read(r, client);
+    }
+    return r.ok();
+}
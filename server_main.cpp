@@ -0,0 +1,42 @@
+#include "game_server.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Usage: server [--record FILE] [--netsim PROFILE] [--budget KIB_PER_S] [--room-threads N]
+//               [--checkpoint FILE] [--epsilon PIXELS]
+int main(int argc, char* argv[])
+{
+    GameServer  game_server;
+    NetRecorder recorder;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+            const char* path = argv[++i];
+            if (!recorder.open(path)) {
+                fprintf(stderr, "Can't open recording file '%s'\n", path);
+                return 1;
+            }
+            game_server.set_recorder(&recorder);
+        } else if (!strcmp(argv[i], "--netsim") && i + 1 < argc) {
+            const NetConditions* conditions = find_net_conditions(argv[++i]);
+            if (!conditions) {
+                print_net_conditions_profiles();
+                return 1;
+            }
+            game_server.set_net_conditions(conditions);
+        } else if (!strcmp(argv[i], "--budget") && i + 1 < argc) {
+            game_server.set_client_bandwidth(static_cast<uint32_t>(atoi(argv[++i])) * 1024);
+        } else if (!strcmp(argv[i], "--room-threads") && i + 1 < argc) {
+            game_server.set_room_threads(static_cast<unsigned>(atoi(argv[++i])));
+        } else if (!strcmp(argv[i], "--checkpoint") && i + 1 < argc) {
+            game_server.set_checkpoint_path(argv[++i]);
+        } else if (!strcmp(argv[i], "--epsilon") && i + 1 < argc) {
+            game_server.set_position_epsilon(static_cast<float>(atof(argv[++i])));
+        }
+    }
+
+    game_server.run();
+    return 0;
+}
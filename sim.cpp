@@ -0,0 +1,111 @@
+#include "sim.h"
+#include "bullet_kernel.h"
+
+#include <vector>
+
+SimSystems sim_init(flecs::world& ecs)
+{
+    SimSystems systems;
+
+    // Simulation systems have no phase, so ecs.progress never runs them. They
+    // are tagged with PhysicsSystem and stepped through their own pipeline at
+    // the fixed rate, spread over the world's worker threads.
+    systems.player_physics
+        = ecs.system<Position, const Direction, const Speed>("PlayerPhysics")
+              .with<PlayerTag>()
+              .with<LocalPlayer>()
+              .kind(0)
+              .multi_threaded()
+              .each([](flecs::iter& it, size_t row, Position& p, const Direction& d, const Speed& s) {
+                  p.x += d.x * s.speed * it.delta_time();
+                  p.y += d.y * s.speed * it.delta_time();
+              });
+    systems.player_physics.add<PhysicsSystem>();
+
+    // Bullets are integrated a whole archetype column at a time. Spent bullets
+    // are collected by the kernel and despawned in a single pass per table.
+    BulletKernel bullet_kernel = select_bullet_kernel();
+
+    systems.bullet_physics
+        = ecs.system<Position, const Direction, const Speed, Range, RectF>("BulletPhysics")
+              .with<BulletTag>()
+              .kind(0)
+              .multi_threaded()
+              .run([bullet_kernel](flecs::iter& it) {
+                  static thread_local std::vector<uint32_t> expired_bullets;
+
+                  while (it.next()) {
+                      if (it.count() == 0)
+                          continue;
+
+                      auto p     = it.field<Position>(0);
+                      auto d     = it.field<const Direction>(1);
+                      auto s     = it.field<const Speed>(2);
+                      auto range = it.field<Range>(3);
+                      auto r     = it.field<RectF>(4);
+
+                      BulletColumns cols { &p[0], &d[0], &s[0], &range[0], &r[0], it.count() };
+                      expired_bullets.resize(it.count());
+
+                      // Deletes are queued on this worker's stage and merged
+                      // on the main thread, where OnRemove observers run.
+                      size_t expired_count = bullet_kernel(cols, it.delta_time(), expired_bullets.data());
+                      for (size_t k = 0; k < expired_count; ++k) {
+                          it.entity(expired_bullets[k]).destruct();
+                      }
+                  }
+              });
+    systems.bullet_physics.add<PhysicsSystem>();
+
+    systems.physics_pipeline = ecs.pipeline()
+                                   .with(flecs::System)
+                                   .with<PhysicsSystem>()
+                                   .build();
+
+    return systems;
+}
+
+void sim_step(flecs::world& ecs, const SimSystems& systems, float dt)
+{
+    ecs.run_pipeline(systems.physics_pipeline, dt);
+}
+
+flecs::entity spawn_player(flecs::world& ecs, uint32_t id, Position position, float speed, Health health, bool is_local, float width, float height)
+{
+    flecs::entity player = is_local ? ecs.entity("LocalPlayer") : ecs.entity();
+    if (is_local)
+        player.add<LocalPlayer>();
+
+    player.add<PlayerTag>()
+        .set<PlayerId>({ id })
+        .add<Direction>()
+        .set<Speed>({ speed })
+        .set<Position>(position)
+        .set<Health>({ health })
+        .set<RectF>({ position.x - width / 2.0f,
+            position.y - height / 2.0f,
+            width,
+            height });
+
+    return player;
+}
+
+flecs::entity spawn_bullet(flecs::world& ecs, Position pos, Direction dir, Speed speed, Damage damage, Range range, bool is_local, float width, float height)
+{
+    flecs::entity bullet = ecs.entity();
+    if (is_local)
+        bullet.add<LocalBullet>();
+
+    bullet.add<BulletTag>()
+        .set<Speed>(speed)
+        .set<Position>(pos)
+        .set<Direction>(dir)
+        .set<Damage>(damage)
+        .set<Range>(range)
+        .set<RectF>({ pos.x - width / 2.0f,
+            pos.y - height / 2.0f,
+            width,
+            height });
+
+    return bullet;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// Gameplay simulation shared by the client, the server tools and the
+// benchmarks. Nothing in here may depend on SDL or on the network layer.
+
+#include "net_messages.h"
+
+#include <cmath>
+#include <cstdint>
+#include <flecs.h>
+
+constexpr int DEFAULT_PLAYER_SIZE { 128 };
+constexpr int DEFAULT_BULLET_SIZE { 14 };
+
+constexpr float BASE_PLAYER_SPEED { 250 };
+constexpr float BASE_PLAYER_HEALTH { 100 };
+
+constexpr float BASE_BULLET_SPEED { 500 };
+constexpr float BASE_BULLET_DAMAGE { 5 };
+constexpr float BASE_BULLET_RANGE { 500 };
+
+constexpr float SIM_FIXED_DT = 1.0f / 60.0f;
+
+struct SimSystems {
+    flecs::system player_physics;
+    flecs::system bullet_physics;
+    flecs::entity physics_pipeline;
+};
+
+// Registers the simulation systems and their pipeline on `ecs`. Worker
+// threads, if any, must already have been set with ecs.set_threads.
+SimSystems sim_init(flecs::world& ecs);
+
+// Advances every PhysicsSystem by one step of `dt` seconds.
+void sim_step(flecs::world& ecs, const SimSystems& systems, float dt);
+
+// Entities are created without anything renderable; the client adds its
+// Texture and grid bookkeeping on top. Sizes are in world units.
+flecs::entity spawn_player(flecs::world& ecs, uint32_t id, Position position, float speed, Health health, bool is_local, float width, float height);
+flecs::entity spawn_bullet(flecs::world& ecs, Position position, Direction direction, Speed speed, Damage damage, Range range, bool is_local, float width, float height);
+
+template <typename T>
+float get_vector_length(T vec)
+{
+    return std::sqrt((vec.x * vec.x) + (vec.y * vec.y));
+}
+
+template <typename T>
+T normalize_vector(T vec)
+{
+    float length = get_vector_length(vec);
+    return (length != 0.0f) ? T { vec.x / length, vec.y / length } : T { 0.0f, 0.0f };
+}
@@ -0,0 +1,70 @@
+#include "bullet_kernel.h"
+#include "sim.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <flecs.h>
+#include <random>
+#include <thread>
+
+// Runs the simulation without a window or a network connection as fast as
+// it will go and reports the achieved tick rate.
+//
+// Usage: sim_headless [--players N] [--bullets N] [--ticks N] [--threads N]
+int main(int argc, char* argv[])
+{
+    int players = 64;
+    int bullets = 100'000;
+    int ticks   = 1'000;
+    int threads = static_cast<int>(std::thread::hardware_concurrency());
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--players"))
+            players = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "--bullets"))
+            bullets = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "--ticks"))
+            ticks = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "--threads"))
+            threads = atoi(argv[i + 1]);
+    }
+
+    flecs::world ecs;
+    ecs.set_threads(threads > 0 ? threads : 1);
+    SimSystems sim = sim_init(ecs);
+
+    std::mt19937                          rng(42);
+    std::uniform_real_distribution<float> coord(-5000.0f, 5000.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    for (int i = 0; i < players; ++i) {
+        spawn_player(ecs, static_cast<uint32_t>(i + 1), Position { coord(rng), coord(rng) },
+            BASE_PLAYER_SPEED, Health { BASE_PLAYER_HEALTH }, i == 0,
+            DEFAULT_PLAYER_SIZE, DEFAULT_PLAYER_SIZE);
+    }
+
+    // Bullets get enough range to outlive the run so the population stays
+    // constant and ticks are comparable with each other.
+    for (int i = 0; i < bullets; ++i) {
+        spawn_bullet(ecs, Position { coord(rng), coord(rng) },
+            normalize_vector(Direction { unit(rng), unit(rng) }),
+            Speed { BASE_BULLET_SPEED }, Damage { BASE_BULLET_DAMAGE },
+            Range { BASE_BULLET_SPEED * SIM_FIXED_DT * (ticks + 1) }, false,
+            DEFAULT_BULLET_SIZE, DEFAULT_BULLET_SIZE);
+    }
+
+    printf("sim_headless: %d players, %d bullets, %d threads, kernel %s\n",
+        players, bullets, threads, bullet_kernel_name(select_bullet_kernel()));
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ticks; ++i) {
+        sim_step(ecs, sim, SIM_FIXED_DT);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%d ticks in %.3f s: %.1f ticks/s, %.3f ms/tick\n",
+        ticks, seconds, ticks / seconds, seconds * 1e3 / ticks);
+    return 0;
+}
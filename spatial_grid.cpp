@@ -0,0 +1,42 @@
+#include "spatial_grid.h"
+
+#include <algorithm>
+
+void SpatialGrid::insert(uint64_t id, GridCell cell, float half_w, float half_h)
+{
+    m_max_half_w = std::max(m_max_half_w, half_w);
+    m_max_half_h = std::max(m_max_half_h, half_h);
+    m_cells[key(cell.x, cell.y)].push_back(id);
+}
+
+void SpatialGrid::remove(uint64_t id, GridCell cell)
+{
+    auto it = m_cells.find(key(cell.x, cell.y));
+    if (it == m_cells.end())
+        return;
+
+    std::vector<uint64_t>& ids = it->second;
+    auto                   pos = std::find(ids.begin(), ids.end(), id);
+    if (pos != ids.end()) {
+        *pos = ids.back();
+        ids.pop_back();
+    }
+
+    // Drop empty cells so memory follows the population, not the distance
+    // bullets have travelled.
+    if (ids.empty())
+        m_cells.erase(it);
+}
+
+void SpatialGrid::move(uint64_t id, GridCell from, GridCell to)
+{
+    remove(id, from);
+    m_cells[key(to.x, to.y)].push_back(id);
+}
+
+void SpatialGrid::clear()
+{
+    m_cells.clear();
+    m_max_half_w = 0.0f;
+    m_max_half_h = 0.0f;
+}
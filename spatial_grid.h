@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Which grid cell an entity is currently filed under. `placed` is false until
+// the entity has been inserted for the first time.
+struct GridCell {
+    int32_t x {};
+    int32_t y {};
+    bool    placed {};
+};
+
+// Uniform hash grid keyed by cell coordinate. Entities are filed by their
+// center only; queries widen the search rectangle by the largest half extent
+// seen so far (a loose grid), so an entity is never filed in more than one
+// cell and moving it is a single remove + insert.
+class SpatialGrid {
+public:
+    explicit SpatialGrid(float cell_size = 256.0f)
+        : m_cell_size(cell_size)
+    {
+    }
+
+    GridCell cell_of(float x, float y) const
+    {
+        return { static_cast<int32_t>(std::floor(x / m_cell_size)),
+            static_cast<int32_t>(std::floor(y / m_cell_size)),
+            true };
+    }
+
+    void insert(uint64_t id, GridCell cell, float half_w, float half_h);
+    void remove(uint64_t id, GridCell cell);
+    void move(uint64_t id, GridCell from, GridCell to);
+    void clear();
+
+    // Widens the loose margin for entities whose size grew after insert.
+    void reserve_extent(float half_w, float half_h)
+    {
+        m_max_half_w = std::max(m_max_half_w, half_w);
+        m_max_half_h = std::max(m_max_half_h, half_h);
+    }
+
+    // Calls fn(id) for every entity whose center lies in a cell overlapping
+    // the rectangle, widened by the loose margin. Callers do the exact test.
+    template <typename Fn>
+    void query(float x, float y, float w, float h, Fn&& fn) const
+    {
+        GridCell lo = cell_of(x - m_max_half_w, y - m_max_half_h);
+        GridCell hi = cell_of(x + w + m_max_half_w, y + h + m_max_half_h);
+
+        for (int32_t cy = lo.y; cy <= hi.y; ++cy) {
+            for (int32_t cx = lo.x; cx <= hi.x; ++cx) {
+                auto it = m_cells.find(key(cx, cy));
+                if (it == m_cells.end())
+                    continue;
+                for (uint64_t id : it->second) {
+                    fn(id);
+                }
+            }
+        }
+    }
+
+    size_t cell_count() const { return m_cells.size(); }
+
+private:
+    static uint64_t key(int32_t x, int32_t y)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+    }
+
+    float m_cell_size;
+    float m_max_half_w {};
+    float m_max_half_h {};
+
+    std::unordered_map<uint64_t, std::vector<uint64_t>> m_cells;
+};
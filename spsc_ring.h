@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Fixed-size queue between exactly one producer thread and one consumer
+// thread, without locks. Slots are written and read in place and never
+// destroyed, so a T holding vectors keeps their capacity from one trip
+// around the ring to the next and steady-state traffic doesn't allocate.
+//
+// Holds CAPACITY - 1 items; CAPACITY must be a power of two.
+template <typename T, size_t CAPACITY>
+class SpscRing {
+    static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+public:
+    // Producer only. Calls fill(slot) and publishes it, or returns false
+    // without calling fill if the ring is full.
+    template <typename Fill>
+    bool push(Fill&& fill)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t next = (head + 1) & MASK;
+        if (next == m_tail.load(std::memory_order_acquire))
+            return false;
+
+        fill(m_slots[head]);
+        m_head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Calls consume(slot) on the oldest item and releases
+    // it, or returns false if the ring is empty.
+    template <typename Consume>
+    bool pop(Consume&& consume)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+            return false;
+
+        consume(m_slots[tail]);
+        m_tail.store((tail + 1) & MASK, std::memory_order_release);
+        return true;
+    }
+
+    // Either side; only a hint while the other side is running.
+    bool empty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t MASK = CAPACITY - 1;
+
+    // Each index on its own cache line so the two sides don't false share.
+    alignas(64) std::atomic<size_t> m_head { 0 }; // next slot to fill
+    alignas(64) std::atomic<size_t> m_tail { 0 }; // next slot to consume
+    alignas(64) T m_slots[CAPACITY];
+};
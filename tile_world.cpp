@@ -0,0 +1,104 @@
+#include "tile_world.h"
+
+#include <cstring>
+
+namespace {
+
+// World files can outgrow a long, which is 32 bits on Windows.
+int seek(FILE* file, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET);
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+}
+
+}
+
+void encode_chunk(const uint8_t* tiles, std::vector<uint8_t>& out)
+{
+    for (int i = 0; i < TILE_CHUNK_TILES;) {
+        uint8_t tile = tiles[i];
+        int     run  = 1;
+        while (i + run < TILE_CHUNK_TILES && tiles[i + run] == tile && run < 255) {
+            ++run;
+        }
+        out.push_back(static_cast<uint8_t>(run));
+        out.push_back(tile);
+        i += run;
+    }
+}
+
+bool decode_chunk(const uint8_t* data, size_t size, uint8_t* tiles)
+{
+    if (size % 2 != 0)
+        return false;
+
+    int filled = 0;
+    for (size_t i = 0; i < size; i += 2) {
+        int     run  = data[i];
+        uint8_t tile = data[i + 1];
+        if (run == 0 || filled + run > TILE_CHUNK_TILES || tile >= static_cast<uint8_t>(Tile::Count))
+            return false;
+        memset(tiles + filled, tile, run);
+        filled += run;
+    }
+    return filled == TILE_CHUNK_TILES;
+}
+
+TileWorldFile::~TileWorldFile()
+{
+    close();
+}
+
+bool TileWorldFile::open(const char* path)
+{
+    close();
+
+    m_file = fopen(path, "rb");
+    if (!m_file)
+        return false;
+
+    if (fread(&m_header, sizeof(m_header), 1, m_file) != 1
+        || memcmp(m_header.magic, TILE_WORLD_MAGIC, sizeof(m_header.magic)) != 0
+        || m_header.version != TILE_WORLD_VERSION
+        || m_header.chunk_size != TILE_CHUNK_SIZE) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TileWorldFile::close()
+{
+    if (m_file) {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+    m_header = {};
+}
+
+bool TileWorldFile::read_chunk(int32_t x, int32_t y, uint8_t* tiles)
+{
+    memset(tiles, static_cast<uint8_t>(Tile::Empty), TILE_CHUNK_TILES);
+
+    int64_t col = static_cast<int64_t>(x) - m_header.min_x;
+    int64_t row = static_cast<int64_t>(y) - m_header.min_y;
+    if (!m_file || col < 0 || row < 0 || col >= m_header.chunks_x || row >= m_header.chunks_y)
+        return true;
+
+    // One small read for the index entry, one for the blob.
+    TileChunkEntry entry;
+    uint64_t       index = sizeof(TileWorldHeader) + (row * m_header.chunks_x + col) * sizeof(TileChunkEntry);
+    if (seek(m_file, index) != 0 || fread(&entry, sizeof(entry), 1, m_file) != 1)
+        return false;
+    if (entry.size == 0)
+        return true;
+
+    m_blob.resize(entry.size);
+    if (seek(m_file, entry.offset) != 0
+        || fread(m_blob.data(), 1, m_blob.size(), m_file) != m_blob.size())
+        return false;
+    return decode_chunk(m_blob.data(), m_blob.size(), tiles);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// A world file is a header, a dense index of chunks_x * chunks_y entries in
+// row order, then the chunk blobs. A chunk is TILE_CHUNK_SIZE squared tile
+// ids, row major, run-length encoded as (count, tile) byte pairs. Chunks
+// that are all Tile::Empty have no blob. Nothing but the header is kept in
+// memory, so the map can be any size.
+
+enum class Tile : uint8_t {
+    Empty,
+    Grass,
+    Sand,
+    Water,
+    Stone,
+    Count,
+};
+
+struct TileInfo {
+    uint8_t r, g, b;
+    bool    solid; // blocks movement
+};
+
+constexpr TileInfo TILE_INFO[] = {
+    { 0, 0, 0, false },       // Empty, not drawn
+    { 62, 110, 52, false },   // Grass
+    { 196, 178, 122, false }, // Sand
+    { 40, 84, 150, true },    // Water
+    { 96, 96, 104, true },    // Stone
+};
+static_assert(sizeof(TILE_INFO) / sizeof(TILE_INFO[0]) == static_cast<size_t>(Tile::Count));
+
+constexpr char     TILE_WORLD_MAGIC[4] = { 'C', 'W', 'L', 'D' };
+constexpr uint16_t TILE_WORLD_VERSION  = 1;
+constexpr int      TILE_CHUNK_SIZE     = 32; // tiles per side
+constexpr int      TILE_CHUNK_TILES    = TILE_CHUNK_SIZE * TILE_CHUNK_SIZE;
+constexpr float    TILE_SIZE           = 32.0f; // world units per tile
+constexpr float    TILE_CHUNK_EXTENT   = TILE_SIZE * TILE_CHUNK_SIZE;
+
+#pragma pack(push, 1)
+struct TileWorldHeader {
+    char     magic[4];
+    uint16_t version;
+    uint16_t chunk_size; // TILE_CHUNK_SIZE when baked
+    int32_t  min_x;      // chunk coordinates of the first index entry
+    int32_t  min_y;
+    uint32_t chunks_x;
+    uint32_t chunks_y;
+};
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+struct TileChunkEntry {
+    uint64_t offset; // from the start of the file
+    uint32_t size;   // 0 for an empty chunk
+};
+#pragma pack(pop)
+
+// Chunk holding world coordinate `v` on either axis.
+inline int32_t chunk_of(float v)
+{
+    return static_cast<int32_t>(std::floor(v / TILE_CHUNK_EXTENT));
+}
+
+inline uint64_t chunk_key(int32_t x, int32_t y)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
+
+// Appends the encoding of TILE_CHUNK_TILES ids to `out`.
+void encode_chunk(const uint8_t* tiles, std::vector<uint8_t>& out);
+// Fills TILE_CHUNK_TILES ids. False if the runs don't cover the chunk
+// exactly or name an unknown tile.
+bool decode_chunk(const uint8_t* data, size_t size, uint8_t* tiles);
+
+// Reads chunks from a world file as they are asked for. One thread at a
+// time; the client's streamer keeps it on its loader thread.
+class TileWorldFile {
+public:
+    ~TileWorldFile();
+
+    bool open(const char* path);
+    void close();
+    bool is_open() const { return m_file != nullptr; }
+
+    // Fills TILE_CHUNK_TILES ids for chunk (x, y). Chunks outside the map
+    // read as empty; false only if the file is damaged.
+    bool read_chunk(int32_t x, int32_t y, uint8_t* tiles);
+
+private:
+    FILE*                m_file {};
+    TileWorldHeader      m_header {};
+    std::vector<uint8_t> m_blob; // scratch
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <algorithm>
+
+// Allows `rate` events per second on average and bursts of up to `burst`.
+// Time is whatever clock the caller ticks, in seconds, so replays that run
+// faster than real time see the same limits as the live server.
+class TokenBucket {
+public:
+    TokenBucket() = default;
+    TokenBucket(float rate, float burst, double now)
+        : m_rate(rate)
+        , m_burst(burst)
+        , m_tokens(burst)
+        , m_last(now)
+    {
+    }
+
+    // Spends one token if there is one.
+    bool take(double now)
+    {
+        if (now > m_last) {
+            m_tokens = std::min(m_burst, m_tokens + static_cast<float>((now - m_last) * m_rate));
+            m_last   = now;
+        }
+        if (m_tokens < 1.0f)
+            return false;
+        m_tokens -= 1.0f;
+        return true;
+    }
+
+private:
+    float  m_rate {};
+    float  m_burst {};
+    float  m_tokens {};
+    double m_last {};
+};
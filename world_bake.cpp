@@ -0,0 +1,217 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "tile_world.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Writes a world file for the client to stream. From MAP.png, one pixel per
+// tile in the nearest TILE_INFO color (transparent pixels are empty);
+// without one, a generated CHUNKS x CHUNKS chunk island. Either way the
+// map is centered on the origin, where players spawn.
+//
+// Usage: world_bake OUTPUT [MAP.png | --generate CHUNKS SEED]
+
+namespace {
+
+constexpr int      DEFAULT_CHUNKS = 64;
+constexpr uint32_t DEFAULT_SEED   = 1;
+
+// Tiles around the origin that are always walkable, so nobody spawns stuck.
+constexpr float SPAWN_CLEARING = 12.0f;
+
+struct TileMap {
+    int                  width {}; // in tiles
+    int                  height {};
+    std::vector<uint8_t> tiles;
+
+    uint8_t at(int x, int y) const
+    {
+        if (x < 0 || y < 0 || x >= width || y >= height)
+            return static_cast<uint8_t>(Tile::Empty);
+        return tiles[static_cast<size_t>(y) * width + x];
+    }
+};
+
+bool load_map(const char* path, TileMap& map)
+{
+    int      channels;
+    uint8_t* pixels = stbi_load(path, &map.width, &map.height, &channels, 4);
+    if (!pixels) {
+        fprintf(stderr, "Failed to load %s: %s\n", path, stbi_failure_reason());
+        return false;
+    }
+
+    map.tiles.resize(static_cast<size_t>(map.width) * map.height);
+    for (size_t i = 0; i < map.tiles.size(); ++i) {
+        const uint8_t* p = pixels + i * 4;
+        if (p[3] < 128) {
+            map.tiles[i] = static_cast<uint8_t>(Tile::Empty);
+            continue;
+        }
+
+        int best          = 1;
+        int best_distance = INT32_MAX;
+        for (int t = 1; t < static_cast<int>(Tile::Count); ++t) {
+            int dr       = p[0] - TILE_INFO[t].r;
+            int dg       = p[1] - TILE_INFO[t].g;
+            int db       = p[2] - TILE_INFO[t].b;
+            int distance = dr * dr + dg * dg + db * db;
+            if (distance < best_distance) {
+                best          = t;
+                best_distance = distance;
+            }
+        }
+        map.tiles[i] = static_cast<uint8_t>(best);
+    }
+    stbi_image_free(pixels);
+    return true;
+}
+
+float lattice(int x, int y, uint32_t seed)
+{
+    uint32_t h = static_cast<uint32_t>(x) * 374761393u + static_cast<uint32_t>(y) * 668265263u + seed * 2246822519u;
+    h          = (h ^ (h >> 13)) * 1274126177u;
+    return static_cast<float>((h ^ (h >> 16)) & 0xFFFF) / 65535.0f;
+}
+
+// Smoothed value noise in [0, 1], features about `scale` tiles across.
+float value_noise(float x, float y, float scale, uint32_t seed)
+{
+    x /= scale;
+    y /= scale;
+    int   ix = static_cast<int>(std::floor(x));
+    int   iy = static_cast<int>(std::floor(y));
+    float fx = x - ix;
+    float fy = y - iy;
+    fx       = fx * fx * (3.0f - 2.0f * fx);
+    fy       = fy * fy * (3.0f - 2.0f * fy);
+
+    float top    = lattice(ix, iy, seed) + (lattice(ix + 1, iy, seed) - lattice(ix, iy, seed)) * fx;
+    float bottom = lattice(ix, iy + 1, seed) + (lattice(ix + 1, iy + 1, seed) - lattice(ix, iy + 1, seed)) * fx;
+    return top + (bottom - top) * fy;
+}
+
+void generate_map(int chunks, uint32_t seed, TileMap& map)
+{
+    map.width  = chunks * TILE_CHUNK_SIZE;
+    map.height = chunks * TILE_CHUNK_SIZE;
+    map.tiles.resize(static_cast<size_t>(map.width) * map.height);
+
+    // The baked header puts chunk chunks / 2 at the origin, which for an
+    // odd count is half a chunk off the middle of the map.
+    float half   = map.width * 0.5f;
+    float origin = static_cast<float>(chunks / 2 * TILE_CHUNK_SIZE);
+    for (int y = 0; y < map.height; ++y) {
+        for (int x = 0; x < map.width; ++x) {
+            float dx = (x - half) / half;
+            float dy = (y - half) / half;
+
+            // An island: high in the middle, sinking towards the edges.
+            float height = 0.55f * value_noise(x, y, 48.0f, seed) + 0.3f * value_noise(x, y, 16.0f, seed + 1)
+                + 0.15f * value_noise(x, y, 6.0f, seed + 2);
+            height -= 0.6f * (dx * dx + dy * dy);
+
+            Tile tile;
+            if (height < 0.05f)
+                tile = Tile::Water;
+            else if (height < 0.12f)
+                tile = Tile::Sand;
+            else if (height > 0.62f)
+                tile = Tile::Stone;
+            else
+                tile = Tile::Grass;
+
+            if (std::hypot(x - origin, y - origin) < SPAWN_CLEARING)
+                tile = Tile::Grass;
+            map.tiles[static_cast<size_t>(y) * map.width + x] = static_cast<uint8_t>(tile);
+        }
+    }
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: world_bake OUTPUT [MAP.png | --generate CHUNKS SEED]\n");
+        return 1;
+    }
+
+    const char* output = argv[1];
+    TileMap     map;
+    if (argc > 2 && strcmp(argv[2], "--generate") != 0) {
+        if (!load_map(argv[2], map))
+            return 1;
+    } else {
+        int      chunks = argc > 3 ? atoi(argv[3]) : DEFAULT_CHUNKS;
+        uint32_t seed   = argc > 4 ? static_cast<uint32_t>(strtoul(argv[4], nullptr, 10)) : DEFAULT_SEED;
+        if (chunks <= 0) {
+            fprintf(stderr, "Bad chunk count %d\n", chunks);
+            return 1;
+        }
+        generate_map(chunks, seed, map);
+    }
+
+    TileWorldHeader header {};
+    memcpy(header.magic, TILE_WORLD_MAGIC, sizeof(header.magic));
+    header.version    = TILE_WORLD_VERSION;
+    header.chunk_size = TILE_CHUNK_SIZE;
+    header.chunks_x   = static_cast<uint32_t>((map.width + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE);
+    header.chunks_y   = static_cast<uint32_t>((map.height + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE);
+    header.min_x      = -static_cast<int32_t>(header.chunks_x / 2);
+    header.min_y      = -static_cast<int32_t>(header.chunks_y / 2);
+
+    std::vector<TileChunkEntry> entries(static_cast<size_t>(header.chunks_x) * header.chunks_y);
+    std::vector<uint8_t>        blobs;
+    uint64_t                    base = sizeof(header) + entries.size() * sizeof(TileChunkEntry);
+
+    uint8_t tiles[TILE_CHUNK_TILES];
+    size_t  empty = 0;
+    for (uint32_t cy = 0; cy < header.chunks_y; ++cy) {
+        for (uint32_t cx = 0; cx < header.chunks_x; ++cx) {
+            bool any = false;
+            for (int ty = 0; ty < TILE_CHUNK_SIZE; ++ty) {
+                for (int tx = 0; tx < TILE_CHUNK_SIZE; ++tx) {
+                    uint8_t tile = map.at(cx * TILE_CHUNK_SIZE + tx, cy * TILE_CHUNK_SIZE + ty);
+                    tiles[ty * TILE_CHUNK_SIZE + tx] = tile;
+                    any |= tile != static_cast<uint8_t>(Tile::Empty);
+                }
+            }
+
+            TileChunkEntry& entry = entries[cy * header.chunks_x + cx];
+            entry                 = {};
+            if (!any) {
+                ++empty;
+                continue;
+            }
+            size_t start = blobs.size();
+            encode_chunk(tiles, blobs);
+            entry.offset = base + start;
+            entry.size   = static_cast<uint32_t>(blobs.size() - start);
+        }
+    }
+
+    FILE* file = fopen(output, "wb");
+    if (!file) {
+        fprintf(stderr, "Can't open %s for writing\n", output);
+        return 1;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(entries.data(), sizeof(TileChunkEntry), entries.size(), file);
+    fwrite(blobs.data(), 1, blobs.size(), file);
+
+    bool ok = ferror(file) == 0;
+    ok      = fclose(file) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Failed writing %s\n", output);
+        return 1;
+    }
+
+    printf("Baked %ux%u chunks (%zu empty) into %s (%llu bytes, %d tiles raw)\n", header.chunks_x, header.chunks_y,
+        empty, output, (unsigned long long)(base + blobs.size()), map.width * map.height);
+    return 0;
+}
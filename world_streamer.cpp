@@ -0,0 +1,245 @@
+#include "world_streamer.h"
+
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <cmath>
+
+WorldStreamer::~WorldStreamer()
+{
+    shutdown();
+}
+
+bool WorldStreamer::open(const char* path)
+{
+    shutdown();
+    if (!m_file.open(path))
+        return false;
+
+    // Every chunk's quads are laid out the same way, so one index list
+    // covers them all.
+    m_indices.resize(TILE_CHUNK_TILES * 6);
+    for (int quad = 0; quad < TILE_CHUNK_TILES; ++quad) {
+        int  v = quad * 4;
+        int* i = &m_indices[quad * 6];
+        i[0]   = v;
+        i[1]   = v + 1;
+        i[2]   = v + 2;
+        i[3]   = v;
+        i[4]   = v + 2;
+        i[5]   = v + 3;
+    }
+
+    m_loader = std::jthread([this](std::stop_token stop) { loader_loop(stop); });
+    return true;
+}
+
+void WorldStreamer::shutdown()
+{
+    if (m_loader.joinable()) {
+        m_loader.request_stop();
+        m_jobs_cv.notify_all();
+        m_loader.join();
+    }
+
+    m_jobs.clear();
+    m_results.clear();
+    m_chunks.clear();
+    m_pending.clear();
+    m_file.close();
+}
+
+WorldStreamer::Range WorldStreamer::range_around(const Camera& cam, int margin)
+{
+    return { chunk_of(cam.x) - margin, chunk_of(cam.y) - margin,
+        chunk_of(cam.x + cam.w) + margin, chunk_of(cam.y + cam.h) + margin };
+}
+
+void WorldStreamer::update(const Camera& cam)
+{
+    if (!is_open())
+        return;
+
+    std::vector<std::unique_ptr<Chunk>> loaded;
+    {
+        std::lock_guard<std::mutex> lock(m_results_mutex);
+        loaded.swap(m_results);
+    }
+
+    // Chunks the camera has moved away from leave, and so do loads that
+    // finished after it did.
+    Range keep = range_around(cam, EVICT_MARGIN);
+    for (std::unique_ptr<Chunk>& chunk : loaded) {
+        uint64_t key = chunk_key(chunk->x, chunk->y);
+        m_pending.erase(key);
+        if (keep.contains(chunk->x, chunk->y))
+            m_chunks[key] = std::move(chunk);
+    }
+    std::erase_if(m_chunks, [&](const auto& entry) { return !keep.contains(entry.second->x, entry.second->y); });
+    {
+        std::lock_guard<std::mutex> lock(m_jobs_mutex);
+        std::erase_if(m_jobs, [&](const Job& job) {
+            if (keep.contains(job.x, job.y))
+                return false;
+            m_pending.erase(chunk_key(job.x, job.y));
+            return true;
+        });
+    }
+
+    // Nearest to the middle of the view first.
+    Range            want  = range_around(cam, STREAM_MARGIN);
+    size_t           limit = std::max(MAX_RESIDENT_CHUNKS, want.area());
+    std::vector<Job> missing;
+    for (int32_t y = want.min_y; y <= want.max_y; ++y) {
+        for (int32_t x = want.min_x; x <= want.max_x; ++x) {
+            uint64_t key = chunk_key(x, y);
+            if (!m_chunks.contains(key) && !m_pending.contains(key))
+                missing.push_back({ x, y });
+        }
+    }
+    if (!missing.empty()) {
+        float cx = (cam.x + cam.w * 0.5f) / TILE_CHUNK_EXTENT - 0.5f;
+        float cy = (cam.y + cam.h * 0.5f) / TILE_CHUNK_EXTENT - 0.5f;
+        std::sort(missing.begin(), missing.end(), [&](const Job& a, const Job& b) {
+            return std::hypot(a.x - cx, a.y - cy) < std::hypot(b.x - cx, b.y - cy);
+        });
+
+        // Room for them comes out of the margin ring, never out of the view.
+        size_t wanted = m_pending.size() + missing.size();
+        if (m_chunks.size() + wanted > limit) {
+            size_t in_view = std::count_if(m_chunks.begin(), m_chunks.end(),
+                [&](const auto& entry) { return want.contains(entry.second->x, entry.second->y); });
+            evict_farthest(cam, std::max(in_view, limit - std::min(limit, wanted)));
+        }
+
+        std::lock_guard<std::mutex> lock(m_jobs_mutex);
+        for (const Job& job : missing) {
+            if (m_chunks.size() + m_pending.size() >= limit)
+                break;
+            m_pending.insert(chunk_key(job.x, job.y));
+            m_jobs.push_back(job);
+        }
+    }
+    m_jobs_cv.notify_one();
+
+    evict_farthest(cam, limit);
+}
+
+// Keeps the `limit` chunks nearest the view, those within STREAM_MARGIN of
+// it ahead of any in the margin ring beyond.
+void WorldStreamer::evict_farthest(const Camera& cam, size_t limit)
+{
+    if (m_chunks.size() <= limit)
+        return;
+
+    Range want = range_around(cam, STREAM_MARGIN);
+    float cx   = (cam.x + cam.w * 0.5f) / TILE_CHUNK_EXTENT - 0.5f;
+    float cy   = (cam.y + cam.h * 0.5f) / TILE_CHUNK_EXTENT - 0.5f;
+
+    std::vector<std::pair<float, uint64_t>> by_distance;
+    for (const auto& [key, chunk] : m_chunks) {
+        float distance = std::hypot(chunk->x - cx, chunk->y - cy);
+        if (!want.contains(chunk->x, chunk->y))
+            distance += 1.0e6f;
+        by_distance.push_back({ distance, key });
+    }
+    std::nth_element(by_distance.begin(), by_distance.begin() + limit, by_distance.end());
+    for (size_t i = limit; i < by_distance.size(); ++i) {
+        m_chunks.erase(by_distance[i].second);
+    }
+}
+
+void WorldStreamer::render(SDL_Renderer* renderer, const Camera& cam, float scale_x, float scale_y)
+{
+    for (const auto& [key, chunk] : m_chunks) {
+        float left = chunk->x * TILE_CHUNK_EXTENT;
+        float top  = chunk->y * TILE_CHUNK_EXTENT;
+        if (chunk->vertices.empty() || left > cam.x + cam.w || left + TILE_CHUNK_EXTENT < cam.x
+            || top > cam.y + cam.h || top + TILE_CHUNK_EXTENT < cam.y)
+            continue;
+
+        m_scratch.assign(chunk->vertices.begin(), chunk->vertices.end());
+        for (SDL_Vertex& v : m_scratch) {
+            v.position.x = (left + v.position.x - cam.x) * scale_x;
+            v.position.y = (top + v.position.y - cam.y) * scale_y;
+        }
+        int count = static_cast<int>(m_scratch.size());
+        SDL_RenderGeometry(renderer, nullptr, m_scratch.data(), count, m_indices.data(), count / 4 * 6);
+    }
+}
+
+bool WorldStreamer::solid_at(float x, float y) const
+{
+    int32_t cx = chunk_of(x);
+    int32_t cy = chunk_of(y);
+    auto    it = m_chunks.find(chunk_key(cx, cy));
+    if (it == m_chunks.end())
+        return false;
+
+    int tx = std::clamp(static_cast<int>((x - cx * TILE_CHUNK_EXTENT) / TILE_SIZE), 0, TILE_CHUNK_SIZE - 1);
+    int ty = std::clamp(static_cast<int>((y - cy * TILE_CHUNK_EXTENT) / TILE_SIZE), 0, TILE_CHUNK_SIZE - 1);
+    return it->second->solid[ty * TILE_CHUNK_SIZE + tx];
+}
+
+void WorldStreamer::loader_loop(std::stop_token stop)
+{
+    uint8_t tiles[TILE_CHUNK_TILES];
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_jobs_mutex);
+            if (!m_jobs_cv.wait(lock, stop, [this] { return !m_jobs.empty(); }))
+                return;
+            job = m_jobs.front();
+            m_jobs.pop_front();
+        }
+
+        // A damaged chunk still comes back, empty, so it isn't asked for
+        // again every frame.
+        auto chunk = std::make_unique<Chunk>();
+        chunk->x   = job.x;
+        chunk->y   = job.y;
+        if (m_file.read_chunk(job.x, job.y, tiles)) {
+            build(tiles, *chunk);
+        } else {
+            SDL_Log("World chunk %d,%d is damaged", job.x, job.y);
+        }
+
+        std::lock_guard<std::mutex> lock(m_results_mutex);
+        m_results.push_back(std::move(chunk));
+    }
+}
+
+// Runs of the same tile along a row become one quad.
+void WorldStreamer::build(const uint8_t* tiles, Chunk& chunk) const
+{
+    for (int ty = 0; ty < TILE_CHUNK_SIZE; ++ty) {
+        const uint8_t* row = tiles + ty * TILE_CHUNK_SIZE;
+        for (int tx = 0; tx < TILE_CHUNK_SIZE;) {
+            uint8_t tile = row[tx];
+            int     run  = 1;
+            while (tx + run < TILE_CHUNK_SIZE && row[tx + run] == tile) {
+                ++run;
+            }
+
+            const TileInfo& info = TILE_INFO[tile];
+            if (info.solid) {
+                for (int i = 0; i < run; ++i) {
+                    chunk.solid.set(ty * TILE_CHUNK_SIZE + tx + i);
+                }
+            }
+            if (tile != static_cast<uint8_t>(Tile::Empty)) {
+                SDL_FColor color { info.r / 255.0f, info.g / 255.0f, info.b / 255.0f, 1.0f };
+                float      x0 = tx * TILE_SIZE;
+                float      x1 = (tx + run) * TILE_SIZE;
+                float      y0 = ty * TILE_SIZE;
+                float      y1 = (ty + 1) * TILE_SIZE;
+                chunk.vertices.push_back({ { x0, y0 }, color, {} });
+                chunk.vertices.push_back({ { x1, y0 }, color, {} });
+                chunk.vertices.push_back({ { x1, y1 }, color, {} });
+                chunk.vertices.push_back({ { x0, y1 }, color, {} });
+            }
+            tx += run;
+        }
+    }
+    chunk.vertices.shrink_to_fit();
+}
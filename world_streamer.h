@@ -0,0 +1,89 @@
+#pragma once
+
+#include "net_messages.h"
+#include "tile_world.h"
+
+#include <SDL3/SDL_render.h>
+#include <bitset>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Keeps the chunks of a world file around the camera resident and drops the
+// rest, so memory follows the view instead of the map. A loader thread
+// reads each chunk and builds its geometry (same-tile runs merged into
+// quads) and collision bits; update() takes finished chunks in on the main
+// thread and render() draws each one with a single SDL_RenderGeometry.
+class WorldStreamer {
+public:
+    ~WorldStreamer();
+
+    bool open(const char* path);
+    void shutdown(); // joins the loader and frees every chunk
+    bool is_open() const { return m_loader.joinable(); }
+
+    // Main thread. Loads chunks within STREAM_MARGIN chunks of the view,
+    // cancels and drops those past EVICT_MARGIN, and takes in finished ones.
+    void update(const Camera& cam);
+    void render(SDL_Renderer* renderer, const Camera& cam, float scale_x, float scale_y);
+
+    // Tiles in chunks that aren't resident yet never block.
+    bool solid_at(float x, float y) const;
+
+    size_t resident() const { return m_chunks.size(); }
+
+private:
+    // Resident chunks past which the farthest from the view go, the margin
+    // ring before anything within STREAM_MARGIN. Raised to whatever the view
+    // plus STREAM_MARGIN covers, so a large window can't starve its own
+    // chunks; a 4K view's whole EVICT_MARGIN range (about 9x8) won't fit.
+    static constexpr size_t MAX_RESIDENT_CHUNKS = 64;
+    static constexpr int    STREAM_MARGIN       = 1;
+    static constexpr int    EVICT_MARGIN        = 2;
+
+    struct Chunk {
+        int32_t                       x {};
+        int32_t                       y {};
+        std::vector<SDL_Vertex>       vertices; // 4 per quad, in world units from the chunk's corner
+        std::bitset<TILE_CHUNK_TILES> solid;
+    };
+
+    struct Job {
+        int32_t x;
+        int32_t y;
+    };
+
+    struct Range {
+        int32_t min_x, min_y, max_x, max_y;
+
+        bool   contains(int32_t x, int32_t y) const { return x >= min_x && x <= max_x && y >= min_y && y <= max_y; }
+        size_t area() const { return static_cast<size_t>(max_x - min_x + 1) * static_cast<size_t>(max_y - min_y + 1); }
+    };
+
+    static Range range_around(const Camera& cam, int margin);
+    void         loader_loop(std::stop_token stop);
+    void         build(const uint8_t* tiles, Chunk& chunk) const;
+    void         evict_farthest(const Camera& cam, size_t limit);
+
+    // main thread only
+    std::unordered_map<uint64_t, std::unique_ptr<Chunk>> m_chunks;  // by chunk_key
+    std::unordered_set<uint64_t>                         m_pending; // queued or loading
+    std::vector<int>                                     m_indices; // shared by every chunk, 6 per quad
+    std::vector<SDL_Vertex>                              m_scratch; // one chunk moved to the screen
+
+    TileWorldFile m_file; // loader thread only once open
+
+    std::mutex                  m_jobs_mutex;
+    std::condition_variable_any m_jobs_cv;
+    std::deque<Job>             m_jobs;
+
+    std::mutex                          m_results_mutex;
+    std::vector<std::unique_ptr<Chunk>> m_results;
+
+    std::jthread m_loader;
+};